@@ -17,11 +17,24 @@
 #include <pulsar/async.h>
 #include <pulsar/daemon.h>
 #include <pulsar/config.h>
+#include <pulsar/config.graph.h>
+#include <pulsar/config.snapshot.h>
+#ifdef CONFIG_ENABLE_DBUS
+#include <pulsar/dbus.h>
+#endif
 #include <pulsar/debug.h>
+#ifdef CONFIG_ENABLE_LADSPA
+#include <pulsar/ladspa.index.h>
+#endif
 #include <pulsar/library.h>
 #include <pulsar/logging.h>
+#ifdef CONFIG_ENABLE_LV2
+#include <pulsar/LV2.h>
+#endif
+#include <pulsar/memory.h>
 #include <pulsar/node.h>
 #include <pulsar/system.h>
+#include <pulsar/util.h>
 
 using namespace std;
 using namespace std::chrono_literals;
@@ -36,6 +49,16 @@ using namespace std::chrono_literals;
 
 static std::shared_ptr<logjam::logmemory> memory_logger;
 static std::list<std::shared_ptr<pulsar::daemon::base>> active_daemons;
+static std::string config_path;
+static std::mutex reload_mutex;
+static std::shared_ptr<pulsar::config::domain> running_config;
+static std::shared_ptr<pulsar::domain> running_domain;
+static std::map<pulsar::string_type, pulsar::node::base *> running_nodes;
+// the hash of the config file the running domain was made from
+static uint64_t running_hash = 0;
+static bool snapshot_enabled = false;
+static pulsar::size_type snapshot_interval_s = 0;
+static std::shared_ptr<pulsar::async::timer> snapshot_timer;
 
 static void init_logging(std::shared_ptr<pulsar::config::file> config_in)
 {
@@ -100,6 +123,147 @@ static void init_debug(std::shared_ptr<pulsar::config::file> config_in)
 
     if (! debug_section) return;
     if (! debug_section.IsMap()) system_fault("debug section of config file was not a map");
+
+    auto realtime_section = debug_section["realtime"];
+
+    if (realtime_section) {
+#ifdef CONFIG_REALTIME_CHECK
+        if (realtime_section["warmup"]) {
+            pulsar::debug::set_realtime_warmup(realtime_section["warmup"].as<pulsar::size_type>());
+        }
+
+        if (realtime_section["allocations"]) {
+            auto action_name = realtime_section["allocations"].as<std::string>();
+            pulsar::debug::set_realtime_allocation_action(pulsar::debug::realtime_action_from_name(action_name));
+        }
+
+        if (realtime_section["locks"]) {
+            auto action_name = realtime_section["locks"].as<std::string>();
+            pulsar::debug::set_realtime_lock_action(pulsar::debug::realtime_action_from_name(action_name));
+        }
+#else
+        log_error("realtime debug settings are present but pulsar was built without REALTIME_CHECK");
+#endif
+    }
+}
+
+static void init_dbus(std::shared_ptr<pulsar::config::file> config_in)
+{
+    auto engine_section = config_in->get_engine();
+    auto dbus_section = engine_section["dbus"];
+
+    if (! dbus_section) return;
+    if (! dbus_section.IsMap()) system_fault("dbus section of config file was not a map");
+
+#ifdef CONFIG_ENABLE_DBUS
+    if (dbus_section["notify_hz"]) {
+        pulsar::dbus::set_notify_rate(dbus_section["notify_hz"].as<pulsar::size_type>());
+    }
+#else
+    log_error("dbus settings are present but pulsar was built without DBus support");
+#endif
+}
+
+static void init_memory(std::shared_ptr<pulsar::config::file> config_in)
+{
+    auto engine_section = config_in->get_engine();
+    auto memory_section = engine_section["memory"];
+    pulsar::memory::settings settings;
+
+    if (! memory_section) return;
+    if (! memory_section.IsMap()) system_fault("memory section of config file was not a map");
+
+    if (memory_section["huge_pages"]) {
+        settings.huge_pages = memory_section["huge_pages"].as<bool>();
+    }
+
+    if (memory_section["prefault"]) {
+        settings.prefault = memory_section["prefault"].as<bool>();
+    }
+
+    if (memory_section["lock"]) {
+        settings.lock = memory_section["lock"].as<bool>();
+    }
+
+    if (memory_section["chunk_kb"]) {
+        settings.chunk_size = memory_section["chunk_kb"].as<pulsar::size_type>() * 1024;
+    }
+
+    pulsar::memory::configure(settings);
+}
+
+static void init_ladspa(std::shared_ptr<pulsar::config::file> config_in)
+{
+    auto ladspa_section = config_in->get_engine()["ladspa"];
+
+    if (! ladspa_section) return;
+    if (! ladspa_section.IsMap()) system_fault("ladspa section of config file was not a map");
+
+#ifdef CONFIG_ENABLE_LADSPA
+    if (ladspa_section["index"]) {
+        pulsar::ladspa::set_index_path(ladspa_section["index"].as<pulsar::string_type>());
+    }
+#else
+    log_error("ladspa settings are present but pulsar was built without LADSPA support");
+#endif
+}
+
+static void init_lv2(std::shared_ptr<pulsar::config::file> config_in)
+{
+    auto lv2_section = config_in->get_engine()["lv2"];
+
+    if (! lv2_section) return;
+    if (! lv2_section.IsMap()) system_fault("lv2 section of config file was not a map");
+
+#ifdef CONFIG_ENABLE_LV2
+    if (lv2_section["cache"]) {
+        pulsar::LV2::set_cache_path(lv2_section["cache"].as<pulsar::string_type>());
+    }
+#else
+    log_error("lv2 settings are present but pulsar was built without LV2 support");
+#endif
+}
+
+// snapshots hold the values of the config: properties and the plugin
+// state so a restart comes back the way it was left; one is saved at
+// shutdown and every interval_s seconds if that is set
+static void init_snapshot(std::shared_ptr<pulsar::config::file> config_in)
+{
+    auto snapshot_section = config_in->get_engine()["snapshot"];
+
+    if (! snapshot_section) return;
+    if (! snapshot_section.IsMap()) system_fault("snapshot section of config file was not a map");
+
+    snapshot_enabled = true;
+
+    if (snapshot_section["interval_s"]) {
+        snapshot_interval_s = snapshot_section["interval_s"].as<pulsar::size_type>();
+    }
+}
+
+static void save_snapshot()
+{
+    auto lock = debug_get_lock(reload_mutex);
+
+    if (running_domain == nullptr) {
+        return;
+    }
+
+    // a node can be removed over DBus after the map was made so they are
+    // looked up again and the guard keeps them from being deleted while
+    // they are saved
+    pulsar::domain::update_guard guard(*running_domain);
+    std::map<pulsar::string_type, pulsar::node::base *> nodes;
+
+    for(auto&& i : running_nodes) {
+        auto node = running_domain->find_node(i.first);
+
+        if (node != nullptr) {
+            nodes[i.first] = node;
+        }
+    }
+
+    pulsar::config::save_snapshot(config_path + ".state", running_hash, nodes);
 }
 
 static void alarm_handler(NDEBUG_UNUSED const int signum_in)
@@ -120,6 +284,59 @@ UNUSED static void init_pulsar(const pulsar::size_type num_threads_in)
     });
 }
 
+// only the nodes, links and presets of the domain are changed; the
+// engine and daemons sections are read once at startup
+static void reload_config()
+{
+    auto lock = debug_get_lock(reload_mutex);
+
+    if (running_domain == nullptr) {
+        log_error("can not reload the configuration before audio processing is started");
+        return;
+    }
+
+    log_info("reloading configuration from ", config_path);
+
+    std::shared_ptr<pulsar::config::file> config;
+    std::shared_ptr<pulsar::config::domain> domain_info;
+
+    // the running config and its hash stay the same so the next reload
+    // is compared against what is really running
+    try {
+        config = pulsar::config::file::make(config_path);
+        domain_info = config->get_domain();
+
+        if (! pulsar::config::reload_nodes(running_config, domain_info, running_domain, running_nodes)) {
+            log_error("the configuration was not reloaded");
+            return;
+        }
+    } catch (const YAML::Exception& error_in) {
+        log_error("could not reload the configuration: ", error_in.what());
+        return;
+    }
+
+    running_config = domain_info;
+    running_hash = pulsar::util::hash(config->get_contents());
+
+    log_info("done reloading configuration");
+}
+
+static void wait_reload_signal()
+{
+    static boost::asio::signal_set reload_signals(pulsar::async::get_boost_io(), SIGHUP);
+
+    reload_signals.async_wait([](const boost::system::error_code& error_in, const int) {
+        if (error_in) {
+            system_fault("got an error from ASIO in the reload signal handler");
+        }
+
+        // the reload waits for a cycle boundary so it can not happen on
+        // a thread that runs the cycle
+        std::thread(reload_config).detach();
+        wait_reload_signal();
+    });
+}
+
 static void init_signals()
 {
     auto&& io = pulsar::async::get_boost_io();
@@ -134,6 +351,8 @@ static void init_signals()
         pulsar::system::shutdown();
     });
 
+    wait_reload_signal();
+
     // fault_signals.async_wait([](const boost::system::error_code& error_in, const int signum_in) {
     //     if (error_in) {
     //         system_fault("got an error from ASIO in the fault signal handler");
@@ -147,6 +366,11 @@ UNUSED static void init(std::shared_ptr<pulsar::config::file> config_in)
 {
     init_logging(config_in);
     init_debug(config_in);
+    init_dbus(config_in);
+    init_memory(config_in);
+    init_ladspa(config_in);
+    init_lv2(config_in);
+    init_snapshot(config_in);
 
     auto engine_node = config_in->get_engine()["threads"];
     pulsar::size_type num_threads = 0;
@@ -190,13 +414,60 @@ std::string get_compressor_state(pulsar::node::base * node_in)
     return buf;
 }
 
+// with graph_cache turned on the nodes are built from <config>.graph
+// when it was made from the same config file and the cache is written
+// out again any time it was not
+static std::map<pulsar::string_type, pulsar::node::base *> make_nodes(std::shared_ptr<pulsar::config::file> config_in, std::shared_ptr<pulsar::config::domain> domain_info_in, std::shared_ptr<pulsar::domain> domain_in)
+{
+    auto cache_node = config_in->get_engine()["graph_cache"];
+
+    if (! cache_node || ! cache_node.as<bool>()) {
+        return pulsar::config::make_nodes(domain_info_in, domain_in);
+    }
+
+    auto source_hash = pulsar::config::graph::hash_source(config_in->get_contents());
+    auto cache_path = config_path + ".graph";
+    auto cached = pulsar::config::graph::load(cache_path, source_hash);
+
+    if (cached != nullptr) {
+        log_info("building nodes from graph cache ", cache_path);
+        return cached->build(domain_in);
+    }
+
+    auto recorder = std::make_shared<pulsar::config::graph>(source_hash);
+
+    domain_info_in->set_recorder(recorder);
+    auto node_map = pulsar::config::make_nodes(domain_info_in, domain_in);
+    domain_info_in->set_recorder(nullptr);
+
+    if (recorder->save(cache_path)) {
+        log_info("wrote graph cache with ", recorder->get_num_ops(), " steps to ", cache_path);
+    } else {
+        log_error("could not write graph cache to ", cache_path);
+    }
+
+    return node_map;
+}
+
 UNUSED static void process_audio(std::shared_ptr<pulsar::config::file> config_in)
 {
     log_info("Configuring audio processing");
 
+    pulsar::util::stopwatch phase_time;
     auto domain_info = config_in->get_domain();
     auto domain = pulsar::config::make_domain(domain_info);
-    auto node_map = pulsar::config::make_nodes(domain_info, domain);
+    auto node_map = make_nodes(config_in, domain_info, domain);
+
+    log_info("built domain ", domain->name, " in ", phase_time.get_ms(), " ms");
+    phase_time.restart();
+
+    auto config_hash = pulsar::util::hash(config_in->get_contents());
+
+    if (snapshot_enabled) {
+        pulsar::config::restore_snapshot(config_path + ".state", config_hash, node_map);
+        log_info("restored snapshot in ", phase_time.get_ms(), " ms");
+        phase_time.restart();
+    }
 
     auto daemons_section = config_in->get_daemons();
     if (daemons_section) {
@@ -212,8 +483,28 @@ UNUSED static void process_audio(std::shared_ptr<pulsar::config::file> config_in
         }
     }
 
+    log_info("started daemons in ", phase_time.get_ms(), " ms");
+    phase_time.restart();
+
     log_info("audio processing is being started");
     domain->activate();
+    log_info("activated domain ", domain->name, " in ", phase_time.get_ms(), " ms");
+
+    {
+        auto lock = debug_get_lock(reload_mutex);
+        running_config = domain_info;
+        running_domain = domain;
+        running_nodes = node_map;
+        running_hash = config_hash;
+    }
+
+    domain->set_reload_handler(reload_config);
+
+    if (snapshot_interval_s > 0) {
+        auto interval = std::chrono::seconds(snapshot_interval_s);
+        snapshot_timer = pulsar::async::timer::make(interval, interval, [](pulsar::async::base_timer&) { save_snapshot(); });
+        snapshot_timer->start();
+    }
 
     std::vector<pulsar::node::base *> compressor_nodes;
     compressor_nodes.push_back(node_map["comp_right"]);
@@ -227,16 +518,34 @@ int main(int argc_in, const char ** argv_in)
         system_fault("must specify a configuration file on the command line");
     }
 
-    auto config = pulsar::config::file::make(argv_in[1]);
+    // logging is not set up until the config file is read so the
+    // times are kept until it is
+    pulsar::util::stopwatch startup_time;
+    pulsar::util::stopwatch phase_time;
+
+    config_path = argv_in[1];
+    auto config = pulsar::config::file::make(config_path);
+    auto config_ms = phase_time.get_ms();
 
+    phase_time.restart();
     init(config);
 
-    log_info("pulsar-dev initialized");
+    log_info("read config file in ", config_ms, " ms");
+    log_info("pulsar-dev initialized in ", phase_time.get_ms(), " ms");
     log_info("Using Boost ", pulsar::system::get_boost_version());
 
     process_audio(config);
+    log_info("startup took ", startup_time.get_ms(), " ms");
     pulsar::system::wait_stopped();
 
     log_info("done processing audio");
+
+    if (snapshot_enabled) {
+        save_snapshot();
+    }
+
+#ifdef CONFIG_REALTIME_CHECK
+    log_info("realtime check: ", pulsar::debug::to_string(pulsar::debug::get_realtime_report()));
+#endif
     return 0;
 }
@@ -11,25 +11,298 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU Lesser General Public License for more details.
 
+#include <algorithm>
+#include <cstring>
+#include <dirent.h>
+#include <map>
 #include <memory>
 
+#include <pulsar/debug.h>
 #include <pulsar/logging.h>
 #include <pulsar/LV2.h>
+#include <pulsar/util.h>
 
 #define OPTIONS_FEATURE_URI "http://lv2plug.in/ns/ext/options#options"
 #define URID_MAP_FEATURE_URI "http://lv2plug.in/ns/ext/urid#map"
+#define URID_UNMAP_FEATURE_URI "http://lv2plug.in/ns/ext/urid#unmap"
+// the subject of the saved state; it is never looked up
+#define STATE_URI "urn:pulsar:state"
+#define CACHE_MAGIC "pulsar lv2 cache"
+// bump when the layout of the cache file changes
+#define CACHE_VERSION 1
 
 namespace pulsar {
 
 namespace LV2 {
 
 static LilvWorld* lilv_world = nullptr;
+// lilv is not thread safe so LV2 nodes take turns with the world even
+// when nodes are initialized from several threads
+static mutex_type lilv_mutex;
+
+struct cache_entry {
+    string_type bundle_uri;
+    size_type bundle_mtime;
+};
+
+// loading every bundle on the system is most of the time it takes to
+// start when there are a lot of plugins installed; with a cache only
+// the bundles of the plugins that are used get loaded and everything
+// is loaded once to rebuild the cache when a plugin is not in it
+static string_type cache_path;
+static std::map<string_type, cache_entry> plugin_cache;
+static bool loaded_all = false;
+
+// the nodes keep their worker alive and it goes away with the last
+// LV2 node of the domain that used it
+static mutex_type workers_mutex;
+static std::map<pulsar::domain *, std::weak_ptr<worker>> workers;
 
 pulsar::node::base * make_node(const string_type& name_in, std::shared_ptr<domain> domain_in)
 {
     return domain_in->make_node<LV2::node>(name_in);
 }
 
+std::shared_ptr<worker> get_worker(pulsar::domain * domain_in)
+{
+    auto lock = debug_get_lock(workers_mutex);
+    auto retval = workers[domain_in].lock();
+
+    if (retval == nullptr) {
+        retval = std::make_shared<worker>();
+        workers[domain_in] = retval;
+    }
+
+    return retval;
+}
+
+worker_queue::worker_queue(const size_type size_in)
+: queue(size_in)
+{ }
+
+bool worker_queue::push(const uint32_t size_in, const void * data_in)
+{
+    auto total_size = sizeof(size_in) + size_in;
+
+    if (size_in > PULSAR_LV2_WORKER_MESSAGE_SIZE || queue.write_available() < total_size) {
+        return false;
+    }
+
+    std::memcpy(push_buffer, &size_in, sizeof(size_in));
+    std::memcpy(push_buffer + sizeof(size_in), data_in, size_in);
+
+    return queue.push(push_buffer, total_size) == total_size;
+}
+
+// the buffer must have room for PULSAR_LV2_WORKER_MESSAGE_SIZE bytes
+bool worker_queue::pop(uint32_t& size_out, uint8_t * data_out)
+{
+    if (queue.read_available() < sizeof(size_out)) {
+        return false;
+    }
+
+    queue.pop(reinterpret_cast<uint8_t *>(&size_out), sizeof(size_out));
+    queue.pop(data_out, size_out);
+
+    return true;
+}
+
+worker::worker()
+{
+    if (sem_init(&pending, 0, 0)) {
+        system_fault("could not create the LV2 worker semaphore: ", strerror(errno));
+    }
+
+    thread = new thread_type(&worker::run, this);
+}
+
+worker::~worker()
+{
+    done = true;
+    wake();
+    thread->join();
+    delete thread;
+    sem_destroy(&pending);
+}
+
+void worker::add_node(node * node_in)
+{
+    auto lock = debug_get_lock(nodes_mutex);
+    nodes.push_back(node_in);
+}
+
+// once this returns the worker will not call into the node again
+void worker::remove_node(node * node_in)
+{
+    auto lock = debug_get_lock(nodes_mutex);
+    nodes.erase(std::remove(nodes.begin(), nodes.end(), node_in), nodes.end());
+}
+
+// sem_post() does not lock so it is safe to call from an audio thread
+void worker::wake()
+{
+    sem_post(&pending);
+}
+
+void worker::run()
+{
+    while(true) {
+        if (sem_wait(&pending)) {
+            continue;
+        }
+
+        if (done) {
+            return;
+        }
+
+        auto lock = debug_get_lock(nodes_mutex);
+
+        for(auto&& node : nodes) {
+            node->do_work();
+        }
+    }
+}
+
+void set_cache_path(const string_type& path_in)
+{
+    if (lilv_world != nullptr) {
+        system_fault("the LV2 cache path must be set before LV2 is initialized");
+    }
+
+    cache_path = path_in;
+}
+
+// the newer of the directory and the manifest so adding, removing or
+// editing the files of a bundle all change it; 0 if the bundle is gone
+static size_type get_bundle_mtime(const string_type& bundle_uri_in)
+{
+    auto path = lilv_file_uri_parse(bundle_uri_in.c_str(), nullptr);
+
+    if (path == nullptr) {
+        return 0;
+    }
+
+    string_type bundle_path(path);
+    lilv_free(path);
+
+    size_type retval = 0;
+
+    for(auto&& i : { bundle_path, bundle_path + "/manifest.ttl" }) {
+        auto mtime = util::get_file_mtime(i);
+
+        if (mtime == 0) {
+            return 0;
+        }
+
+        retval = std::max(retval, mtime);
+    }
+
+    return retval;
+}
+
+static void load_cache()
+{
+    string_type contents;
+
+    if (! util::read_file(cache_path, contents)) {
+        return;
+    }
+
+    util::binary_reader reader(contents);
+
+    if (reader.read_string() != CACHE_MAGIC || reader.read_size() != CACHE_VERSION) {
+        log_info("ignoring LV2 cache with the wrong format: ", cache_path);
+        return;
+    }
+
+    auto num_entries = reader.read_size();
+
+    for(size_type i = 0; i < num_entries && ! reader.is_failed(); i++) {
+        auto uri = reader.read_string();
+        auto& entry = plugin_cache[uri];
+        entry.bundle_uri = reader.read_string();
+        entry.bundle_mtime = reader.read_size();
+    }
+
+    if (reader.is_failed() || ! reader.at_end()) {
+        log_error("ignoring damaged LV2 cache: ", cache_path);
+        plugin_cache.clear();
+    }
+}
+
+// must be called with the lilv mutex held
+static void rebuild_cache()
+{
+    auto plugins = lilv_world_get_all_plugins(lilv_world);
+    util::binary_writer writer;
+
+    plugin_cache.clear();
+
+    LILV_FOREACH(plugins, i, plugins) {
+        auto plugin = lilv_plugins_get(plugins, i);
+        auto& entry = plugin_cache[lilv_node_as_uri(lilv_plugin_get_uri(plugin))];
+        entry.bundle_uri = lilv_node_as_uri(lilv_plugin_get_bundle_uri(plugin));
+        entry.bundle_mtime = get_bundle_mtime(entry.bundle_uri);
+    }
+
+    writer.write_string(CACHE_MAGIC);
+    writer.write_size(CACHE_VERSION);
+    writer.write_size(plugin_cache.size());
+
+    for(auto&& i : plugin_cache) {
+        writer.write_string(i.first);
+        writer.write_string(i.second.bundle_uri);
+        writer.write_size(i.second.bundle_mtime);
+    }
+
+    if (! util::write_file(cache_path, writer.get_buffer())) {
+        log_error("could not write LV2 cache to ", cache_path);
+        return;
+    }
+
+    log_info("wrote LV2 cache with ", plugin_cache.size(), " plugins to ", cache_path);
+}
+
+static void load_all()
+{
+    log_trace("Loading everything into the lilv world");
+    lilv_world_load_all(lilv_world);
+    loaded_all = true;
+}
+
+// must be called with the lilv mutex held
+static const LilvPlugin * find_plugin(const LilvNode * uri_in)
+{
+    auto plugins = lilv_world_get_all_plugins(lilv_world);
+    auto plugin = lilv_plugins_get_by_uri(plugins, uri_in);
+
+    if (plugin != nullptr || loaded_all) {
+        return plugin;
+    }
+
+    auto found = plugin_cache.find(lilv_node_as_uri(uri_in));
+
+    if (found != plugin_cache.end() && found->second.bundle_mtime == get_bundle_mtime(found->second.bundle_uri)) {
+        log_debug("loading LV2 bundle ", found->second.bundle_uri);
+
+        auto bundle_uri = lilv_new_uri(lilv_world, found->second.bundle_uri.c_str());
+        lilv_world_load_bundle(lilv_world, bundle_uri);
+        lilv_node_free(bundle_uri);
+
+        plugin = lilv_plugins_get_by_uri(plugins, uri_in);
+
+        if (plugin != nullptr) {
+            return plugin;
+        }
+    }
+
+    log_info("LV2 plugin is not in the cache or the cache is out of date: ", lilv_node_as_uri(uri_in));
+    load_all();
+    rebuild_cache();
+
+    return lilv_plugins_get_by_uri(plugins, uri_in);
+}
+
 void init()
 {
     log_trace("Creating a new lilv world");
@@ -39,8 +312,11 @@ void init()
         system_fault("Could not create a new lilv world");
     }
 
-    log_trace("Loading everything into the lilv world");
-    lilv_world_load_all(lilv_world);
+    if (cache_path == "") {
+        load_all();
+    } else {
+        load_cache();
+    }
 
     library::register_node_factory("pulsar::LV2::node", make_node);
 }
@@ -50,10 +326,17 @@ node::node(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in
 {
     add_property("node:class", property::value_type::string).value->set("pulsar::LV2::node");
     add_property("plugin:uri", property::value_type::string);
+
+    can_split_run = true;
 }
 
 node::~node()
 {
+    if (worker != nullptr) {
+        worker->remove_node(this);
+        worker = nullptr;
+    }
+
     if (instance != nullptr) {
         lilv_instance_free(instance);
         instance = nullptr;
@@ -67,6 +350,10 @@ void node::create_ports(const LilvPlugin * plugin_in)
     LilvNode * lv2_AudioPort          = lilv_new_uri(lilv_world, LV2_CORE__AudioPort);
     LilvNode * lv2_ControlPort        = lilv_new_uri(lilv_world, LV2_CORE__ControlPort);
     LilvNode * lv2_connectionOptional = lilv_new_uri(lilv_world, LV2_CORE__connectionOptional);
+    LilvNode * atom_AtomPort          = lilv_new_uri(lilv_world, LV2_ATOM__AtomPort);
+    LilvNode * atom_bufferType        = lilv_new_uri(lilv_world, LV2_ATOM__bufferType);
+    LilvNode * midi_MidiEvent         = lilv_new_uri(lilv_world, LV2_MIDI__MidiEvent);
+    LilvNode * rsz_minimumSize        = lilv_new_uri(lilv_world, LV2_RESIZE_PORT__minimumSize);
     size_type numports = lilv_plugin_get_num_ports(plugin_in);
     float * defaults = static_cast<float *>(calloc(numports, sizeof(float)));
 
@@ -76,18 +363,18 @@ void node::create_ports(const LilvPlugin * plugin_in)
 
     lilv_plugin_get_port_ranges_float(plugin_in, NULL, NULL, defaults);
 
+    std::vector<std::pair<size_type, property::storage *>> controls;
+
     for(size_type i = 0; i < numports; i++) {
         const LilvPort * lport = lilv_plugin_get_port_by_index(plugin_in, i);
         auto lilv_port_name = lilv_port_get_name(plugin_in, lport);
         auto string_port_name = lilv_node_as_string(lilv_port_name);
 
-        port_name_to_index[string_port_name] = i;
-
         if (lilv_port_is_a(plugin_in, lport, lv2_AudioPort)) {
             if (lilv_port_is_a(plugin_in, lport, lv2_InputPort)) {
-                audio.add_input(string_port_name);
+                input_bindings.emplace_back(i, audio.add_input(string_port_name));
             } else if (lilv_port_is_a(plugin_in, lport, lv2_OutputPort)) {
-                audio.add_output(string_port_name);
+                output_bindings.emplace_back(i, audio.add_output(string_port_name));
             } else {
                 system_fault("LV2 audio port was neither input nor output");
             }
@@ -106,15 +393,55 @@ void node::create_ports(const LilvPlugin * plugin_in)
 
             auto& control = add_property(property_name, property::value_type::real);
             control.value->set(defaults[i]);
-            lilv_instance_connect_port(instance, i, &control.value->get_real());
+            controls.emplace_back(i, control.value.get());
+        } else if (lilv_port_is_a(plugin_in, lport, atom_AtomPort)) {
+            auto buffer_type = lilv_port_get(plugin_in, lport, atom_bufferType);
+
+            if (buffer_type == nullptr || string_type(lilv_node_as_uri(buffer_type)) != LV2_ATOM__Sequence) {
+                system_fault("LV2 atom port ", string_port_name, " is not a sequence");
+            }
+
+            lilv_node_free(buffer_type);
+
+            atom_port new_port;
+            new_port.port_index = i;
+            new_port.is_input = lilv_port_is_a(plugin_in, lport, lv2_InputPort);
+            new_port.takes_midi = new_port.is_input && lilv_port_supports_event(plugin_in, lport, midi_MidiEvent);
+
+            auto minimum_size = lilv_port_get(plugin_in, lport, rsz_minimumSize);
+
+            if (minimum_size != nullptr) {
+                if (lilv_node_is_int(minimum_size) && lilv_node_as_int(minimum_size) > 0) {
+                    new_port.capacity = std::max(new_port.capacity, static_cast<size_type>(lilv_node_as_int(minimum_size)));
+                }
+
+                lilv_node_free(minimum_size);
+            }
+
+            if (new_port.takes_midi) {
+                has_midi_input = true;
+            }
+
+            atom_ports.push_back(new_port);
         } else {
-            system_fault("LV2 port was neither audio nor control");
+            system_fault("LV2 port was neither audio, control nor atom");
         }
 
         lilv_node_free(lilv_port_name);
     }
 
+    // the values move when they are packed
+    pack_values();
+
+    for(auto&& i : controls) {
+        lilv_instance_connect_port(instance, i.first, &i.second->get_real());
+    }
+
     free(defaults);
+    lilv_node_free(rsz_minimumSize);
+    lilv_node_free(midi_MidiEvent);
+    lilv_node_free(atom_bufferType);
+    lilv_node_free(atom_AtomPort);
     lilv_node_free(lv2_connectionOptional);
     lilv_node_free(lv2_ControlPort);
     lilv_node_free(lv2_AudioPort);
@@ -128,6 +455,24 @@ static LV2_URID urid_map_wrapper(LV2_URID_Map_Handle handle, const char *uri_in)
     return node->urid_map_handler(uri_in);
 }
 
+static const char * urid_unmap_wrapper(LV2_URID_Unmap_Handle handle, LV2_URID urid_in)
+{
+    auto node = (LV2::node *)handle;
+    return node->urid_unmap_handler(urid_in);
+}
+
+static LV2_Worker_Status schedule_work_wrapper(LV2_Worker_Schedule_Handle handle, uint32_t size_in, const void * data_in)
+{
+    auto node = (LV2::node *)handle;
+    return node->schedule_work_handler(size_in, data_in);
+}
+
+static LV2_Worker_Status respond_wrapper(LV2_Worker_Respond_Handle handle, uint32_t size_in, const void * data_in)
+{
+    auto node = (LV2::node *)handle;
+    return node->respond_handler(size_in, data_in);
+}
+
 LV2_URID node::urid_map_handler(const char *uri_in)
 {
     string_type uri(uri_in);
@@ -139,58 +484,219 @@ LV2_URID node::urid_map_handler(const char *uri_in)
 
     auto next_urid = ++current_urid;
     urid_map[uri] = next_urid;
+    urid_unmap[next_urid] = uri;
     return next_urid;
 }
 
+const char * node::urid_unmap_handler(const LV2_URID urid_in)
+{
+    auto found = urid_unmap.find(urid_in);
+
+    if (found == urid_unmap.end()) {
+        return nullptr;
+    }
+
+    return found->second.c_str();
+}
+
 void node::init_features()
 {
     urid_map_instance = { this, urid_map_wrapper };
     urid_map_feature.URI = URID_MAP_FEATURE_URI;
     urid_map_feature.data = static_cast<void *>(&urid_map_instance);
 
-    empty_options_instance[0].subject = 0;
-    empty_options_instance[0].key = 0;
-    empty_options_instance[0].size = 0;
-    empty_options_instance[0].type = 0;
-    empty_options_feature.URI = OPTIONS_FEATURE_URI;
-    empty_options_feature.data = empty_options_instance;
+    urid_unmap_instance = { this, urid_unmap_wrapper };
+    urid_unmap_feature.URI = URID_UNMAP_FEATURE_URI;
+    urid_unmap_feature.data = static_cast<void *>(&urid_unmap_instance);
+
+    atom_sequence_urid = urid_map_handler(LV2_ATOM__Sequence);
+    atom_chunk_urid = urid_map_handler(LV2_ATOM__Chunk);
+    midi_event_urid = urid_map_handler(LV2_MIDI__MidiEvent);
+
+    options_feature.URI = OPTIONS_FEATURE_URI;
+    options_feature.data = options_instance;
+
+    bounded_block_length_feature.URI = LV2_BUF_SIZE__boundedBlockLength;
+    bounded_block_length_feature.data = nullptr;
+    fixed_block_length_feature.URI = LV2_BUF_SIZE__fixedBlockLength;
+    fixed_block_length_feature.data = nullptr;
+    power_of_2_block_length_feature.URI = LV2_BUF_SIZE__powerOf2BlockLength;
+    power_of_2_block_length_feature.data = nullptr;
 }
 
-LV2_Feature * node::handle_feature(const string_type& name_in)
+// run() is split at the samples values change at so a fixed or power
+// of 2 block length is only promised to plugins that can not work
+// without it; those nodes always run the whole buffer at once
+LV2_Feature * node::handle_feature(const string_type& name_in, const bool required_in)
 {
     if (name_in == OPTIONS_FEATURE_URI) {
-        return &empty_options_feature;
+        return &options_feature;
+    } else if (name_in == LV2_BUF_SIZE__boundedBlockLength) {
+        return &bounded_block_length_feature;
+    } else if (name_in == LV2_BUF_SIZE__fixedBlockLength && required_in) {
+        can_split_run = false;
+        return &fixed_block_length_feature;
+    } else if (name_in == LV2_BUF_SIZE__powerOf2BlockLength && required_in) {
+        auto buffer_size = domain->buffer_size;
+
+        if (buffer_size == 0 || (buffer_size & (buffer_size - 1)) != 0) {
+            system_fault("LV2 plugin for node ", name, " needs a power of 2 block length but the buffer size is ", buffer_size);
+        }
+
+        can_split_run = false;
+        return &power_of_2_block_length_feature;
     } else if (name_in == URID_MAP_FEATURE_URI) {
         return &urid_map_feature;
+    } else if (name_in == URID_UNMAP_FEATURE_URI) {
+        return &urid_unmap_feature;
+    } else if (name_in == LV2_WORKER__schedule) {
+        return init_worker();
+    }
+
+    return nullptr;
+}
+
+// done after the features are handled since they decide if the run
+// can be split
+void node::init_options()
+{
+    auto int_urid = urid_map_handler(LV2_ATOM__Int);
+    size_type option_num = 0;
+
+    min_block_length = can_split_run ? 1 : domain->buffer_size;
+    max_block_length = domain->buffer_size;
+    nominal_block_length = domain->buffer_size;
+
+    auto add_option = [&](const char * key_in, const int32_t * value_in) {
+        options_instance[option_num++] = { LV2_OPTIONS_INSTANCE, 0, urid_map_handler(key_in), sizeof(int32_t), int_urid, value_in };
+    };
+
+    add_option(LV2_BUF_SIZE__minBlockLength, &min_block_length);
+    add_option(LV2_BUF_SIZE__maxBlockLength, &max_block_length);
+    add_option(LV2_BUF_SIZE__nominalBlockLength, &nominal_block_length);
+    add_option(LV2_BUF_SIZE__sequenceSize, &sequence_size);
+
+    assert(option_num == PULSAR_LV2_NUM_OPTIONS);
+    options_instance[option_num] = { LV2_OPTIONS_INSTANCE, 0, 0, 0, 0, nullptr };
+}
+
+LV2_Feature * node::init_worker()
+{
+    if (worker == nullptr) {
+        work_requests = std::make_unique<worker_queue>(PULSAR_LV2_WORKER_QUEUE_SIZE);
+        work_responses = std::make_unique<worker_queue>(PULSAR_LV2_WORKER_QUEUE_SIZE);
+        worker = get_worker(domain.get());
+
+        worker_schedule_instance = { this, schedule_work_wrapper };
+        worker_schedule_feature.URI = LV2_WORKER__schedule;
+        worker_schedule_feature.data = static_cast<void *>(&worker_schedule_instance);
+    }
+
+    return &worker_schedule_feature;
+}
+
+// called by the plugin from run() in an audio thread
+LV2_Worker_Status node::schedule_work_handler(const uint32_t size_in, const void * data_in)
+{
+    if (worker_interface == nullptr) {
+        return LV2_WORKER_ERR_UNKNOWN;
+    }
+
+    if (! work_requests->push(size_in, data_in)) {
+        return LV2_WORKER_ERR_NO_SPACE;
+    }
+
+    worker->wake();
+
+    return LV2_WORKER_SUCCESS;
+}
+
+// called by the plugin from work() in the worker thread
+LV2_Worker_Status node::respond_handler(const uint32_t size_in, const void * data_in)
+{
+    if (! work_responses->push(size_in, data_in)) {
+        return LV2_WORKER_ERR_NO_SPACE;
     }
 
-    system_fault("LV2 plugin needed an unsupported feature: ", name_in);
+    return LV2_WORKER_SUCCESS;
+}
+
+void node::do_work()
+{
+    auto handle = lilv_instance_get_handle(instance);
+    uint32_t size;
+
+    while(work_requests->pop(size, request_buffer)) {
+        worker_interface->work(handle, respond_wrapper, this, size, request_buffer);
+    }
+}
+
+// the responses are handed over in the audio thread before the plugin
+// runs again as the worker extension requires
+void node::deliver_responses()
+{
+    auto handle = lilv_instance_get_handle(instance);
+    uint32_t size;
+
+    while(work_responses->pop(size, response_buffer)) {
+        worker_interface->work_response(handle, size, response_buffer);
+    }
 }
 
 void node::create_instance(const LilvPlugin * plugin_in)
 {
     auto required_features = lilv_plugin_get_required_features(plugin_in);
-    auto num_features = lilv_nodes_size(required_features);
-
-    LV2_Feature * feature_list[num_features + 1];
-    feature_list[num_features] = nullptr;
-    size_type feature_num = 0;
+    auto optional_features = lilv_plugin_get_optional_features(plugin_in);
+    std::vector<LV2_Feature *> feature_list;
 
     log_debug("LV2 required features for node ", name, ":");
     LILV_FOREACH(nodes, i, required_features) {
         auto node = lilv_nodes_get(required_features, i);
         auto value = lilv_node_as_string(node);
+        auto feature = handle_feature(value, true);
         log_debug("  ", value);
 
-        feature_list[feature_num] = handle_feature(value);
-        feature_num++;
+        if (feature == nullptr) {
+            system_fault("LV2 plugin needed an unsupported feature: ", value);
+        }
+
+        feature_list.push_back(feature);
+    }
+
+    // optional features that are supported are given to the plugin and
+    // the rest are left out
+    log_debug("LV2 optional features for node ", name, ":");
+    LILV_FOREACH(nodes, i, optional_features) {
+        auto node = lilv_nodes_get(optional_features, i);
+        auto value = lilv_node_as_string(node);
+        auto feature = handle_feature(value, false);
+        log_debug("  ", value, feature == nullptr ? " (unsupported)" : "");
+
+        if (feature != nullptr) {
+            feature_list.push_back(feature);
+        }
     }
 
-    instance = lilv_plugin_instantiate(plugin_in, domain->sample_rate, feature_list);
+    feature_list.push_back(nullptr);
+    init_options();
+    lilv_nodes_free(optional_features);
+    lilv_nodes_free(required_features);
+
+    instance = lilv_plugin_instantiate(plugin_in, domain->sample_rate, feature_list.data());
 
     if (instance == nullptr) {
         system_fault("could not create LV2 instance");
     }
+
+    if (worker != nullptr) {
+        worker_interface = static_cast<const LV2_Worker_Interface *>(lilv_instance_get_extension_data(instance, LV2_WORKER__interface));
+
+        if (worker_interface == nullptr) {
+            log_error("LV2 plugin for node ", name, " can schedule work but has no worker interface");
+        } else {
+            worker->add_node(this);
+        }
+    }
 }
 
 void node::init()
@@ -206,13 +712,13 @@ void node::init()
         system_fault("No LV2 URI was specified for node: ", name);
     }
 
+    auto lock = debug_get_lock(lilv_mutex);
     auto lilv_uri = lilv_new_uri(lilv_world, string_uri.c_str());
     if (! lilv_uri) {
         system_fault("Invalid plugin URI for node ", name, " : ", string_uri);
     }
 
-    const LilvPlugins * plugins = lilv_world_get_all_plugins(lilv_world);
-    const LilvPlugin * plugin  = lilv_plugins_get_by_uri(plugins, lilv_uri);
+    plugin = find_plugin(lilv_uri);
 
     if (plugin == nullptr) {
         system_fault("Could not find a LV2 plugin with URI of ", string_uri);
@@ -222,41 +728,262 @@ void node::init()
     create_ports(plugin);
 
     lilv_node_free(lilv_uri);
+    lock.unlock();
 
     pulsar::node::filter::init();
 }
 
 void node::activate()
 {
+    for(auto&& port : atom_ports) {
+        port.buffer.assign((port.capacity + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+        port.sequence = reinterpret_cast<LV2_Atom_Sequence *>(port.buffer.data());
+        port.sequence->atom.type = atom_sequence_urid;
+        lv2_atom_sequence_clear(port.sequence);
+        lilv_instance_connect_port(instance, port.port_index, port.sequence);
+    }
+
     lilv_instance_activate(instance);
 
     pulsar::node::filter::activate();
 }
 
+// the state interface allows save() to run at the same time as run()
+// so the node does not have to stop to be saved; port values are not
+// included since they are already kept as properties
+string_type node::save_state()
+{
+    if (lilv_instance_get_extension_data(instance, LV2_STATE__interface) == nullptr) {
+        return "";
+    }
+
+    auto lock = debug_get_lock(lilv_mutex);
+    auto state = lilv_state_new_from_instance(plugin, instance, &urid_map_instance, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, nullptr);
+
+    if (state == nullptr) {
+        log_error("could not get the LV2 state of node ", name);
+        return "";
+    }
+
+    auto state_string = lilv_state_to_string(lilv_world, &urid_map_instance, &urid_unmap_instance, state, STATE_URI, nullptr);
+    string_type retval;
+
+    if (state_string != nullptr) {
+        retval = state_string;
+        lilv_free(state_string);
+    }
+
+    lilv_state_free(state);
+
+    return retval;
+}
+
+// restore() is in the instantiation threading class so this must be
+// done before the node is activated
+void node::restore_state(const string_type& state_in)
+{
+    if (state_in == "") {
+        return;
+    }
+
+    auto lock = debug_get_lock(lilv_mutex);
+    auto state = lilv_state_new_from_string(lilv_world, &urid_map_instance, state_in.c_str());
+
+    if (state == nullptr) {
+        log_error("could not parse the saved LV2 state of node ", name);
+        return;
+    }
+
+    lilv_state_restore(state, instance, nullptr, nullptr, 0, nullptr);
+    lilv_state_free(state);
+}
+
+string_type node::get_init_problem()
+{
+    auto string_uri = get_property("plugin:uri").value->get_string();
+
+    if (string_uri == "") {
+        return util::to_string("No LV2 URI was specified for node: ", name);
+    }
+
+    auto lock = debug_get_lock(lilv_mutex);
+    auto lilv_uri = lilv_new_uri(lilv_world, string_uri.c_str());
+
+    if (! lilv_uri) {
+        return util::to_string("Invalid plugin URI for node ", name, " : ", string_uri);
+    }
+
+    auto found = find_plugin(lilv_uri);
+    lilv_node_free(lilv_uri);
+
+    if (found == nullptr) {
+        return util::to_string("Could not find a LV2 plugin with URI of ", string_uri);
+    }
+
+    return "";
+}
+
+// the ports are described by the turtle files of the bundle and any of
+// them can change so every file in the bundle is included
+std::vector<string_type> node::get_plugin_files()
+{
+    auto lock = debug_get_lock(lilv_mutex);
+    auto path = lilv_file_uri_parse(lilv_node_as_uri(lilv_plugin_get_bundle_uri(plugin)), nullptr);
+    lock.unlock();
+
+    if (path == nullptr) {
+        return {};
+    }
+
+    string_type bundle_path(path);
+    lilv_free(path);
+
+    std::vector<string_type> retval = { bundle_path };
+    auto dir = opendir(bundle_path.c_str());
+
+    if (dir == nullptr) {
+        return retval;
+    }
+
+    while(auto entry = readdir(dir)) {
+        string_type file_name(entry->d_name);
+
+        if (file_name != "." && file_name != "..") {
+            retval.push_back(bundle_path + "/" + file_name);
+        }
+    }
+
+    closedir(dir);
+
+    return retval;
+}
+
+template <class T>
+void node::connect_binding(port_binding<T>& binding_in, const size_type offset_in)
+{
+    auto pointer = binding_in.channel->get_buffer()->get_pointer() + offset_in;
+
+    if (pointer != binding_in.connected) {
+        lilv_instance_connect_port(instance, binding_in.port_index, pointer);
+        binding_in.connected = pointer;
+    }
+}
+
+bool node::receive(const uint8_t * message_in, const size_type size_in, const size_type offset_in)
+{
+    if (! has_midi_input || size_in == 0 || size_in > PULSAR_LV2_MIDI_MESSAGE_SIZE) {
+        return false;
+    }
+
+    midi_event event;
+    event.offset = offset_in;
+    event.size = size_in;
+    std::memcpy(event.data, message_in, size_in);
+
+    return midi_events.bounded_push(event);
+}
+
+// messages from different sources can arrive out of order so each one
+// is put in place by its offset as it is taken off the queue
+void node::collect_events()
+{
+    midi_event event;
+
+    num_cycle_events = 0;
+
+    while(num_cycle_events < cycle_events.size() && midi_events.pop(event)) {
+        auto position = num_cycle_events;
+
+        while(position > 0 && cycle_events[position - 1].offset > event.offset) {
+            cycle_events[position] = cycle_events[position - 1];
+            position--;
+        }
+
+        cycle_events[position] = event;
+        num_cycle_events++;
+    }
+}
+
+// the sequences are reset by rewriting the header so nothing is cleared
+// or allocated; output ports are handed to the plugin with their whole
+// capacity as the LV2 atom extension requires
+void node::fill_sequences(const size_type offset_in, const size_type length_in)
+{
+    struct {
+        LV2_Atom_Event header;
+        uint8_t data[PULSAR_LV2_MIDI_MESSAGE_SIZE];
+    } event;
+
+    for(auto&& port : atom_ports) {
+        auto body_capacity = port.capacity - sizeof(LV2_Atom);
+
+        if (! port.is_input) {
+            port.sequence->atom.type = atom_chunk_urid;
+            port.sequence->atom.size = body_capacity;
+            continue;
+        }
+
+        port.sequence->atom.type = atom_sequence_urid;
+        lv2_atom_sequence_clear(port.sequence);
+
+        if (! port.takes_midi) {
+            continue;
+        }
+
+        for(size_type i = 0; i < num_cycle_events; i++) {
+            auto& midi = cycle_events[i];
+
+            if (midi.offset < offset_in || midi.offset >= offset_in + length_in) {
+                continue;
+            }
+
+            event.header.time.frames = midi.offset - offset_in;
+            event.header.body.type = midi_event_urid;
+            event.header.body.size = midi.size;
+            std::memcpy(event.data, midi.data, midi.size);
+
+            if (lv2_atom_sequence_append_event(port.sequence, body_capacity, &event.header) == nullptr) {
+                break;
+            }
+        }
+    }
+}
+
+// a message that claims to be past the end of the buffer is given to
+// the plugin at the last sample instead of being lost
 void node::run()
 {
-    for (auto&& port_name : audio.get_input_names()) {
-        auto buffer = audio.get_input(port_name)->get_buffer();
-        auto port_num = port_name_to_index[port_name];
-        lilv_instance_connect_port(instance, port_num, buffer->get_pointer());
+    collect_events();
+
+    for(size_type i = 0; i < num_cycle_events; i++) {
+        cycle_events[i].offset = std::min(cycle_events[i].offset, domain->buffer_size - 1);
     }
 
-    for (auto&& port_name : audio.get_output_names()) {
-        auto buffer = audio.get_output(port_name)->get_buffer();
-        auto port_num = port_name_to_index[port_name];
-        lilv_instance_connect_port(instance, port_num, buffer->get_pointer());
+    pulsar::node::filter::run();
+}
+
+void node::run_block(const size_type offset_in, const size_type length_in)
+{
+    if (! atom_ports.empty()) {
+        fill_sequences(offset_in, length_in);
     }
 
-    lilv_instance_run(instance, domain->buffer_size);
+    for (auto&& binding : input_bindings) {
+        connect_binding(binding, offset_in);
+    }
+
+    for (auto&& binding : output_bindings) {
+        connect_binding(binding, offset_in);
+    }
 
-    for (auto&& port_name : audio.get_input_names()) {
-        auto port_num = port_name_to_index[port_name];
-        lilv_instance_connect_port(instance, port_num, nullptr);
+    if (worker_interface != nullptr) {
+        deliver_responses();
     }
 
-    for (auto&& port_name : audio.get_output_names()) {
-        auto port_num = port_name_to_index[port_name];
-        lilv_instance_connect_port(instance, port_num, nullptr);
+    lilv_instance_run(instance, length_in);
+
+    if (worker_interface != nullptr && worker_interface->end_run != nullptr) {
+        worker_interface->end_run(lilv_instance_get_handle(instance));
     }
 }
 
@@ -13,6 +13,13 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <boost/lockfree/queue.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <semaphore.h>
+
+#include <pulsar/midi.h>
 #include <pulsar/node.h>
 #include <pulsar/library.h>
 #include <pulsar/system.h>
@@ -22,35 +29,173 @@ namespace pulsar {
 namespace LV2 {
 
 #include <lilv/lilv.h>
+#include <lv2/lv2plug.in/ns/ext/atom/atom.h>
+#include <lv2/lv2plug.in/ns/ext/atom/util.h>
+#include <lv2/lv2plug.in/ns/ext/buf-size/buf-size.h>
+#include <lv2/lv2plug.in/ns/ext/midi/midi.h>
 #include <lv2/lv2plug.in/ns/ext/options/options.h>
+#include <lv2/lv2plug.in/ns/ext/resize-port/resize-port.h>
+#include <lv2/lv2plug.in/ns/ext/state/state.h>
+#include <lv2/lv2plug.in/ns/ext/worker/worker.h>
+
+// the largest request or response a plugin can pass to its worker
+#define PULSAR_LV2_WORKER_MESSAGE_SIZE 4096
+// bytes of requests or responses that can be waiting at once per node
+#define PULSAR_LV2_WORKER_QUEUE_SIZE 65536
+// bytes given to an atom port that does not ask for a minimum size
+#define PULSAR_LV2_ATOM_BUFFER_SIZE 8192
+// MIDI messages that can be waiting for the next cycle of a node
+#define PULSAR_LV2_MIDI_QUEUE_SIZE 256
+// only channel messages are passed on so this is the longest one
+#define PULSAR_LV2_MIDI_MESSAGE_SIZE 3
+// the buffer size options given to every plugin
+#define PULSAR_LV2_NUM_OPTIONS 4
+
+class node;
+
+// resolved once at init so run() does not have to look up ports by name
+template <class T>
+struct port_binding {
+    size_type port_index;
+    T * channel;
+    sample_type * connected = nullptr;
+
+    port_binding(const size_type port_index_in, T * channel_in)
+    : port_index(port_index_in), channel(channel_in)
+    { }
+};
+
+// one side is an audio thread and the other is the worker thread; a
+// message goes in with a single push so the reader never sees part of
+// one and neither side allocates or locks
+class worker_queue {
+    boost::lockfree::spsc_queue<uint8_t> queue;
+    uint8_t push_buffer[sizeof(uint32_t) + PULSAR_LV2_WORKER_MESSAGE_SIZE];
+
+    public:
+    worker_queue(const size_type size_in);
+    bool push(const uint32_t size_in, const void * data_in);
+    bool pop(uint32_t& size_out, uint8_t * data_out);
+};
+
+// the plugins of a domain hand slow work like loading files to one
+// thread that does not run at a realtime priority so it never takes
+// time from an audio thread
+class worker {
+    mutex_type nodes_mutex;
+    std::vector<node *> nodes;
+    sem_t pending;
+    std::atomic<bool> done = ATOMIC_VAR_INIT(false);
+    thread_type * thread = nullptr;
+    void run();
+
+    public:
+    worker();
+    ~worker();
+    void add_node(node * node_in);
+    void remove_node(node * node_in);
+    void wake();
+};
+
+struct midi_event {
+    // the sample in the cycle the message happens at
+    size_type offset;
+    uint32_t size;
+    uint8_t data[PULSAR_LV2_MIDI_MESSAGE_SIZE];
+};
+
+// the buffer is made when the node is activated and never changes size
+// after that; 64 bit elements keep it aligned the way atoms need
+struct atom_port {
+    size_type port_index;
+    bool is_input = false;
+    bool takes_midi = false;
+    size_type capacity = PULSAR_LV2_ATOM_BUFFER_SIZE;
+    std::vector<uint64_t> buffer;
+    LV2_Atom_Sequence * sequence = nullptr;
+};
 
 pulsar::node::base * make_node(const string_type& name_in, std::shared_ptr<domain> domain_in);
+std::shared_ptr<worker> get_worker(pulsar::domain * domain_in);
+void set_cache_path(const string_type& path_in);
 void init();
 
-class node : public pulsar::node::filter {
+class node : public pulsar::node::filter, public pulsar::midi::receiver {
 
     protected:
+    const LilvPlugin * plugin = nullptr;
     LilvInstance * instance = nullptr;
     LV2_URID_Map urid_map_instance;
     LV2_Feature urid_map_feature;
-    LV2_Options_Option empty_options_instance[1];
-    LV2_Feature empty_options_feature;
+    LV2_URID_Unmap urid_unmap_instance;
+    LV2_Feature urid_unmap_feature;
+    // what the options tell the plugin about the length of run()
+    int32_t min_block_length = 0;
+    int32_t max_block_length = 0;
+    int32_t nominal_block_length = 0;
+    int32_t sequence_size = PULSAR_LV2_ATOM_BUFFER_SIZE;
+    // the list ends with an option that is all zeros
+    LV2_Options_Option options_instance[PULSAR_LV2_NUM_OPTIONS + 1];
+    LV2_Feature options_feature;
+    LV2_Feature bounded_block_length_feature;
+    LV2_Feature fixed_block_length_feature;
+    LV2_Feature power_of_2_block_length_feature;
+    LV2_Worker_Schedule worker_schedule_instance;
+    LV2_Feature worker_schedule_feature;
+    std::shared_ptr<LV2::worker> worker;
+    const LV2_Worker_Interface * worker_interface = nullptr;
+    // only made for plugins that use a worker
+    std::unique_ptr<worker_queue> work_requests;
+    std::unique_ptr<worker_queue> work_responses;
+    uint8_t request_buffer[PULSAR_LV2_WORKER_MESSAGE_SIZE];
+    uint8_t response_buffer[PULSAR_LV2_WORKER_MESSAGE_SIZE];
     LV2_URID current_urid = 0;
     std::map<string_type, LV2_URID> urid_map;
-    std::map<string_type, size_type> port_name_to_index;
+    // a map so the strings handed out by unmap never move
+    std::map<LV2_URID, string_type> urid_unmap;
+    std::vector<port_binding<audio::input>> input_bindings;
+    std::vector<port_binding<audio::output>> output_bindings;
+    std::vector<atom_port> atom_ports;
+    bool has_midi_input = false;
+    LV2_URID atom_sequence_urid = 0;
+    LV2_URID atom_chunk_urid = 0;
+    LV2_URID midi_event_urid = 0;
+    // fixed capacity so the MIDI sources and the audio thread never
+    // allocate; each cycle the messages are moved into a list ordered
+    // by offset
+    boost::lockfree::queue<midi_event, boost::lockfree::capacity<PULSAR_LV2_MIDI_QUEUE_SIZE>> midi_events;
+    std::array<midi_event, PULSAR_LV2_MIDI_QUEUE_SIZE> cycle_events;
+    size_type num_cycle_events = 0;
 
     void init_features();
-    LV2_Feature * handle_feature(const string_type& name_in);
+    LV2_Feature * handle_feature(const string_type& name_in, const bool required_in);
+    void init_options();
+    LV2_Feature * init_worker();
+    void deliver_responses();
+    void collect_events();
+    void fill_sequences(const size_type offset_in, const size_type length_in);
     void create_instance(const LilvPlugin * plugin_in);
     void create_ports(const LilvPlugin* plugin_in);
+    template <class T>
+    void connect_binding(port_binding<T>& binding_in, const size_type offset_in);
     virtual void init() override;
     virtual void run() override;
+    virtual void run_block(const size_type offset_in, const size_type length_in) override;
 
     public:
     node(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in);
     virtual ~node();
     LV2_URID urid_map_handler(const char * uri_in);
+    const char * urid_unmap_handler(const LV2_URID urid_in);
+    LV2_Worker_Status schedule_work_handler(const uint32_t size_in, const void * data_in);
+    LV2_Worker_Status respond_handler(const uint32_t size_in, const void * data_in);
+    void do_work();
     virtual void activate() override;
+    virtual bool receive(const uint8_t * message_in, const size_type size_in, const size_type offset_in) override;
+    virtual string_type save_state() override;
+    virtual void restore_state(const string_type& state_in) override;
+    virtual std::vector<string_type> get_plugin_files() override;
+    virtual string_type get_init_problem() override;
 };
 
 } // namespace LV2
@@ -0,0 +1,198 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#include <cassert>
+#include <poll.h>
+#include <vector>
+
+#include <pulsar/alsa.h>
+#include <pulsar/domain.h>
+#include <pulsar/logging.h>
+#include <pulsar/system.h>
+
+namespace pulsar {
+
+namespace alsa {
+
+void init()
+{
+    library::register_daemon_factory("pulsar::alsa::midi", make_midi);
+}
+
+std::shared_ptr<midi> make_midi(const string_type& name_in)
+{
+    return std::make_shared<midi>(name_in);
+}
+
+midi::midi(const string_type& name_in)
+: daemon::base(name_in)
+{ }
+
+midi::~midi()
+{
+    if (running) {
+        stop();
+    }
+}
+
+void midi::init(const YAML::Node& yaml_in)
+{
+    log_debug("initializing ALSA MIDI daemon");
+
+    if (yaml_in["client_name"]) {
+        client_name = yaml_in["client_name"].as<string_type>();
+    }
+
+    if (yaml_in["domain"]) {
+        domain_name = yaml_in["domain"].as<string_type>();
+    }
+
+    for(auto&& i : yaml_in["connect"]) {
+        connect_list.push_back(i.as<string_type>());
+    }
+
+    control_map.init(yaml_in["map"]);
+}
+
+void midi::start()
+{
+    log_info("starting ALSA MIDI daemon");
+
+    assert(! running);
+
+    std::shared_ptr<pulsar::domain> domain;
+
+    for(auto&& i : get_domains()) {
+        if (domain_name == "" || i->name == domain_name) {
+            domain = i;
+            break;
+        }
+    }
+
+    if (domain == nullptr) {
+        system_fault("ALSA MIDI daemon ", name, " could not find domain ", domain_name);
+    }
+
+    control_map.resolve(domain);
+
+    if (snd_seq_open(&sequencer, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK) < 0) {
+        system_fault("could not open the ALSA sequencer");
+    }
+
+    snd_seq_set_client_name(sequencer, client_name.c_str());
+
+    port = snd_seq_create_simple_port(
+        sequencer, "control_in",
+        SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+        SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION
+    );
+
+    if (port < 0) {
+        system_fault("could not create ALSA sequencer port: ", snd_strerror(port));
+    }
+
+    for(auto&& i : connect_list) {
+        snd_seq_addr_t address;
+
+        if (snd_seq_parse_address(sequencer, &address, i.c_str()) < 0) {
+            log_error("could not find ALSA sequencer port ", i);
+            continue;
+        }
+
+        if (snd_seq_connect_from(sequencer, port, address.client, address.port) < 0) {
+            log_error("could not connect ALSA sequencer port ", i);
+        }
+    }
+
+    running = true;
+    receive_thread = new thread_type(&midi::receive_loop, this);
+}
+
+void midi::stop()
+{
+    log_info("stopping ALSA MIDI daemon ", name);
+
+    running = false;
+
+    if (receive_thread != nullptr) {
+        receive_thread->join();
+        delete receive_thread;
+        receive_thread = nullptr;
+    }
+
+    if (sequencer != nullptr) {
+        snd_seq_close(sequencer);
+        sequencer = nullptr;
+        port = -1;
+    }
+
+    auto dropped = control_map.get_dropped();
+
+    if (dropped > 0) {
+        log_error("ALSA MIDI daemon ", name, " dropped ", dropped, " updates because the queue was full");
+    }
+}
+
+void midi::receive_loop()
+{
+    auto num_descriptors = snd_seq_poll_descriptors_count(sequencer, POLLIN);
+    std::vector<pollfd> descriptors(num_descriptors);
+
+    snd_seq_poll_descriptors(sequencer, descriptors.data(), num_descriptors, POLLIN);
+
+    while(running) {
+        if (poll(descriptors.data(), num_descriptors, PULSAR_ALSA_POLL_TIMEOUT_MS) <= 0) {
+            continue;
+        }
+
+        snd_seq_event_t * event = nullptr;
+
+        while(snd_seq_event_input(sequencer, &event) >= 0) {
+            handle_event(event);
+        }
+    }
+}
+
+void midi::handle_event(const snd_seq_event_t * event_in)
+{
+    switch(event_in->type) {
+        case SND_SEQ_EVENT_CONTROLLER: {
+            const uint8_t message[3] = {
+                static_cast<uint8_t>(0xB0 | (event_in->data.control.channel & 0x0F)),
+                static_cast<uint8_t>(event_in->data.control.param & 0x7F),
+                static_cast<uint8_t>(event_in->data.control.value & 0x7F),
+            };
+
+            control_map.handle(message, sizeof(message), 0);
+            break;
+        }
+        case SND_SEQ_EVENT_NOTEON:
+        case SND_SEQ_EVENT_NOTEOFF: {
+            const uint8_t message[3] = {
+                static_cast<uint8_t>((event_in->type == SND_SEQ_EVENT_NOTEON ? 0x90 : 0x80) | (event_in->data.note.channel & 0x0F)),
+                static_cast<uint8_t>(event_in->data.note.note & 0x7F),
+                static_cast<uint8_t>(event_in->data.note.velocity & 0x7F),
+            };
+
+            control_map.handle(message, sizeof(message), 0);
+            break;
+        }
+        case SND_SEQ_EVENT_NONREGPARAM:
+            control_map.handle_nrpn(event_in->data.control.channel & 0x0F, event_in->data.control.param, event_in->data.control.value, 0);
+            break;
+    }
+}
+
+} // namespace alsa
+
+} // namespace pulsar
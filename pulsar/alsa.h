@@ -0,0 +1,63 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+
+#include <pulsar/daemon.h>
+#include <pulsar/library.h>
+#include <pulsar/midi.h>
+#include <pulsar/thread.h>
+
+// how often the receive thread checks if it should stop
+#define PULSAR_ALSA_POLL_TIMEOUT_MS 100
+
+extern "C" {
+#include <alsa/asoundlib.h>
+}
+
+namespace pulsar {
+
+namespace alsa {
+
+// MIDI control messages from the ALSA sequencer; events are not tied
+// to a JACK period so they take effect at the start of the next cycle
+class midi : public daemon::base {
+    string_type client_name = "pulsar_midi";
+    string_type domain_name;
+    std::list<string_type> connect_list;
+    snd_seq_t * sequencer = nullptr;
+    int port = -1;
+    std::atomic<bool> running = ATOMIC_VAR_INIT(false);
+    thread_type * receive_thread = nullptr;
+    pulsar::midi::map control_map;
+    void receive_loop();
+    void handle_event(const snd_seq_event_t * event_in);
+
+    public:
+    midi(const string_type& name_in);
+    virtual ~midi();
+    virtual void init(const YAML::Node& yaml_in) override;
+    virtual void start() override;
+    virtual void stop() override;
+};
+
+void init();
+std::shared_ptr<midi> make_midi(const string_type& name_in);
+
+} // namespace alsa
+
+} // namespace pulsar
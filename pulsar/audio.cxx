@@ -11,6 +11,7 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU Lesser General Public License for more details.
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
@@ -20,6 +21,7 @@
 #include <pulsar/audio.util.h>
 #include <pulsar/debug.h>
 #include <pulsar/logging.h>
+#include <pulsar/memory.h>
 #include <pulsar/node.h>
 #include <pulsar/system.h>
 
@@ -28,17 +30,11 @@
 
 namespace pulsar {
 
-namespace audio {
-
-static pool_allocator_type<pulsar::sample_type> sample_buffer_allocator;
-
-} // namespace audio
-
 audio::buffer::~buffer()
 {
     if (own_memory) {
         assert(pointer != nullptr);
-        sample_buffer_allocator.deallocate(pointer, size);
+        memory::deallocate(pointer, size);
         pointer = nullptr;
     }
 }
@@ -54,17 +50,29 @@ void audio::buffer::init(const pulsar::size_type buffer_size_in, pulsar::sample_
     } else {
         own_memory = true;
 
-        pointer = sample_buffer_allocator.allocate(buffer_size_in);
-        zero();
+        pointer = memory::allocate(buffer_size_in);
 
         if (pointer == nullptr) {
             system_fault("could not allocate memory for audio buffer");
         }
+
+        zero();
     }
 
     return;
 }
 
+// point the buffer at memory owned by someone else; this can be
+// done every cycle and does not allocate
+void audio::buffer::wrap(const pulsar::size_type buffer_size_in, pulsar::sample_type * pointer_in)
+{
+    assert(! own_memory);
+    assert(pointer_in != nullptr);
+
+    size = buffer_size_in;
+    pointer = pointer_in;
+}
+
 pulsar::size_type audio::buffer::get_size()
 {
     assert(pointer != nullptr);
@@ -83,9 +91,10 @@ void audio::buffer::zero()
     audio::util::pcm_zero(pointer, size);
 }
 
-void audio::buffer::mix(std::shared_ptr<audio::buffer> mix_from_in)
+void audio::buffer::mix(audio::buffer * mix_from_in)
 {
     assert(pointer != nullptr);
+    assert(mix_from_in != nullptr);
 
     if (size != mix_from_in->size) {
         system_fault("attempt to mix buffers of different size");
@@ -94,6 +103,11 @@ void audio::buffer::mix(std::shared_ptr<audio::buffer> mix_from_in)
     audio::util::pcm_mix(pointer, mix_from_in->get_pointer(), size);
 }
 
+void audio::buffer::mix(std::shared_ptr<audio::buffer> mix_from_in)
+{
+    mix(mix_from_in.get());
+}
+
 void audio::buffer::set(pulsar::sample_type * pointer_in, const size_type size_in)
 {
     assert(pointer != nullptr);
@@ -105,8 +119,10 @@ void audio::buffer::set(pulsar::sample_type * pointer_in, const size_type size_i
     audio::util::pcm_set(pointer, pointer_in, size_in);
 }
 
-void audio::buffer::set(std::shared_ptr<audio::buffer> buffer_in)
+void audio::buffer::set(audio::buffer * buffer_in)
 {
+    assert(buffer_in != nullptr);
+
     if (size != buffer_in->size) {
         system_fault("attempt to set buffer contents from buffer of different size");
     }
@@ -115,6 +131,11 @@ void audio::buffer::set(std::shared_ptr<audio::buffer> buffer_in)
     set(src_p, size);
 }
 
+void audio::buffer::set(std::shared_ptr<audio::buffer> buffer_in)
+{
+    set(buffer_in.get());
+}
+
 void audio::buffer::scale(const float scale_in)
 {
     assert(pointer != nullptr);
@@ -138,6 +159,13 @@ node::base * audio::channel::get_parent()
     return parent;
 }
 
+// the list is only swapped by a patch so it is read by the control
+// thread that makes the next one
+const std::vector<audio::link *>& audio::channel::get_links()
+{
+    return links;
+}
+
 audio::input::input(const string_type& name_in, node::base * parent_in)
 : audio::channel(name_in, parent_in)
 { }
@@ -149,10 +177,7 @@ void audio::input::reset_cycle()
 {
     llog_trace({ return pulsar::util::to_string("resetting audio input ", to_string()); });
 
-    {
-        auto lock = debug_get_lock(link_buffers_mutex);
-        link_buffers.empty();
-    }
+    ready_count.store(0);
 
     for(auto&& link : links) {
         link->reset();
@@ -163,6 +188,26 @@ void audio::input::reset_cycle()
     links_waiting.store(waiting_things);
 }
 
+void audio::input::register_link(link * link_in)
+{
+    audio::channel::register_link(link_in);
+    update_ready_slots();
+}
+
+// the slots and the mix buffer are sized when the topology
+// changes so nothing has to be allocated while a cycle runs
+void audio::input::update_ready_slots()
+{
+    auto num_slots = links.size() + num_forwards_to_us;
+
+    ready_buffers.resize(num_slots, nullptr);
+
+    if (num_slots > 1 && mix_buffer == nullptr) {
+        mix_buffer = audio::buffer::make();
+        mix_buffer->init(parent->get_domain()->buffer_size);
+    }
+}
+
 void audio::input::link_to(audio::output * source_in) {
     auto new_link = new audio::link(source_in, this);
     register_link(new_link);
@@ -210,21 +255,24 @@ void audio::input::forward_to(node::base * node_in, const string_type& port_name
     }
 }
 
-void audio::input::link_ready(audio::link * link_in, std::shared_ptr<audio::buffer> buffer_in)
+void audio::input::link_ready(audio::link * link_in, audio::buffer * buffer_in)
 {
     llog_trace({ return pulsar::util::to_string("in link_ready() for ", to_string()); });
 
     assert(link_in != nullptr);
     assert(buffer_in != nullptr);
 
-    size_type now_waiting;
+    auto slot = ready_count++;
 
-    {
-        auto lock = debug_get_lock(link_buffers_mutex);
-        link_buffers[link_in] = buffer_in;
+    if (slot >= ready_buffers.size()) {
+        system_fault("sanity check failed; more buffers were ready than links for ", to_string());
     }
 
-    now_waiting = --links_waiting;
+    ready_buffers[slot] = buffer_in;
+
+    // the decrement orders the slot store before the last
+    // link_ready() call that goes on to read all the slots
+    auto now_waiting = --links_waiting;
 
     llog_trace({ return pulsar::util::to_string("waiting buffers: ", now_waiting, "; ", to_string()); });
 
@@ -233,7 +281,7 @@ void audio::input::link_ready(audio::link * link_in, std::shared_ptr<audio::buff
 #endif
 
     if (now_waiting == 0) {
-        std::shared_ptr<audio::buffer> forward_buffer = nullptr;
+        audio::buffer * forward_buffer = nullptr;
 
         // If forwarding is happening then the buffer to send along
         // needs to be fetched before init/reset happens in the cycle.
@@ -263,6 +311,7 @@ pulsar::size_type audio::input::get_links_waiting()
 void audio::input::register_forward(input_forward *)
 {
     num_forwards_to_us++;
+    update_ready_slots();
 }
 
 // if there are no links in the input channel then this
@@ -275,40 +324,39 @@ void audio::input::register_forward(input_forward *)
 // if there is more than one link in the input channel then
 // returns a pointer to the internal buffer after it is used to
 // sum all the buffers from the linked output channels
-std::shared_ptr<audio::buffer> audio::input::get_buffer()
+audio::buffer * audio::input::get_buffer()
 {
-    auto num_links = links.size() + num_forwards_to_us;
-    auto input_name = parent->name + ":" + name;
+    auto num_links = ready_buffers.size();
 
     if (num_links == 0) {
-        log_trace("returning pointer to zero buffer for ", input_name);
+        llog_trace({ return pulsar::util::to_string("returning pointer to zero buffer for ", to_string()); });
         return parent->get_domain()->get_zero_buffer();
     } else if (num_links == 1) {
-        log_trace("returning pointer to link's ready buffer for ", input_name);
-        auto lock = debug_get_lock(link_buffers_mutex);
-        assert(link_buffers.begin() != link_buffers.end());
-        assert(link_buffers.begin()->second != nullptr);
-        return link_buffers.begin()->second;
+        llog_trace({ return pulsar::util::to_string("returning pointer to link's ready buffer for ", to_string()); });
+        assert(ready_count.load() == 1);
+        assert(ready_buffers[0] != nullptr);
+        return ready_buffers[0];
     } else {
-        log_trace("returning pointer to mix buffer for", input_name);
+        llog_trace({ return pulsar::util::to_string("returning pointer to mix buffer for ", to_string()); });
         return mix_outputs();
     }
 }
 
-std::shared_ptr<audio::buffer> audio::input::mix_outputs()
+audio::buffer * audio::input::mix_outputs()
 {
-    llog_trace({ return pulsar::util::to_string("mixing ", links.size(), " input buffers for ", parent->name, ":", name); });
+    llog_trace({ return pulsar::util::to_string("mixing ", ready_buffers.size(), " input buffers for ", to_string()); });
 
-    assert(links.size() + num_forwards_to_us > 1);
+    assert(ready_buffers.size() > 1);
+    assert(ready_count.load() == ready_buffers.size());
+    assert(mix_buffer != nullptr);
 
-    auto mix_buffer = audio::buffer::make();
-    mix_buffer->init(parent->get_domain()->buffer_size);
+    mix_buffer->set(ready_buffers[0]);
 
-    for(auto&& buffer : link_buffers) {
-        mix_buffer->mix(buffer.second);
+    for(size_type i = 1; i < ready_buffers.size(); i++) {
+        mix_buffer->mix(ready_buffers[i]);
     }
 
-    return mix_buffer;
+    return mix_buffer.get();
 }
 
 const string_type audio::input::to_string()
@@ -322,11 +370,26 @@ audio::output::output(const string_type& name_in, node::base * parent_in)
 : audio::channel(name_in, parent_in)
 { }
 
+void audio::output::activate()
+{
+    if (own_buffer != nullptr) {
+        return;
+    }
+
+    own_buffer = audio::buffer::make();
+    own_buffer->init(parent->get_domain()->buffer_size);
+    external_buffer = audio::buffer::make();
+}
+
 void audio::output::init_cycle()
 {
     llog_trace({ return pulsar::util::to_string("starting cycle for ", to_string()); });
-    buffer = audio::buffer::make();
-    buffer->init(parent->get_domain()->buffer_size);
+
+    if (own_buffer == nullptr) {
+        system_fault("output was not activated: ", to_string());
+    }
+
+    buffer = own_buffer.get();
 }
 
 void audio::output::reset_cycle()
@@ -338,20 +401,33 @@ void audio::output::reset_cycle()
 void audio::output::register_forward(output_forward *)
 {
     forwards_to_us++;
+    forwarded_buffers.reserve(forwards_to_us);
 }
 
-std::shared_ptr<audio::buffer> audio::output::get_buffer()
+audio::buffer * audio::output::get_buffer()
 {
     assert(buffer != nullptr);
     return buffer;
 }
 
-void audio::output::set_buffer(std::shared_ptr<audio::buffer> buffer_in)
+void audio::output::set_buffer(audio::buffer * buffer_in)
 {
     assert(buffer_in != nullptr);
 
     buffer = buffer_in;
-    notify();
+    notify(buffer_in);
+}
+
+// use memory supplied by the caller, such as a sound card buffer,
+// as the contents of the output for this cycle
+void audio::output::set_external_buffer(sample_type * pointer_in)
+{
+    if (external_buffer == nullptr) {
+        system_fault("output was not activated: ", to_string());
+    }
+
+    external_buffer->wrap(parent->get_domain()->buffer_size, pointer_in);
+    set_buffer(external_buffer.get());
 }
 
 void audio::output::link_to(audio::input * sink_in)
@@ -403,31 +479,36 @@ void audio::output::forward_to(node::base * node_in, const string_type& port_nam
 }
 
 void audio::output::notify()
+{
+    notify(buffer);
+}
+
+void audio::output::notify(audio::buffer * buffer_in)
 {
     // FIXME make an assert macro for this
-    if (buffer == nullptr) {
+    if (buffer_in == nullptr) {
         system_fault("buffer was null for ", parent->name, ":", name);
     }
 
     for(auto&& forward : forwards) {
-        log_trace(parent->name, ":", name, " telling forwarder about available buffer");
-        forward->to->add_forwarded_buffer(buffer);
+        llog_trace({ return pulsar::util::to_string(parent->name, ":", name, " telling forwarder about available buffer"); });
+        forward->to->add_forwarded_buffer(buffer_in);
     }
 
     for(auto&& link : links) {
-        link->notify(buffer);
+        link->notify(buffer_in);
     }
 }
 
-void audio::output::add_forwarded_buffer(std::shared_ptr<audio::buffer> buffer_in)
+void audio::output::add_forwarded_buffer(audio::buffer * buffer_in)
 {
     auto lock = debug_get_lock(forward_mutex);
 
     forwarded_buffers.push_back(buffer_in);
-    std::shared_ptr<audio::buffer> buffer = nullptr;
+    audio::buffer * buffer = nullptr;
     auto available = forwarded_buffers.size();
 
-    log_trace(parent->name, ":", name, " forwards to us: ", forwards_to_us, "; available buffers: ", available);
+    llog_trace({ return pulsar::util::to_string(parent->name, ":", name, " forwards to us: ", forwards_to_us, "; available buffers: ", available); });
 
     if (available > forwards_to_us) {
         system_fault("sanity check failed; available buffers: ", available, "; forwards to us: ", forwards_to_us);
@@ -472,7 +553,7 @@ void audio::link::reset()
     available_condition.notify_all();
 }
 
-void audio::link::notify(std::shared_ptr<audio::buffer> ready_buffer_in, const bool blocking_in)
+void audio::link::notify(audio::buffer * ready_buffer_in, const bool blocking_in)
 {
     llog_trace({ return pulsar::util::to_string("got notification for ", to_string()); });
 
@@ -511,6 +592,246 @@ audio::output_forward::output_forward(output * from_in, output * to_in)
 : from(from_in), to(to_in)
 { }
 
+audio::patch::~patch()
+{
+    // links that were never put in place belong to the patch and
+    // links that were taken out are no longer used by any channel
+    auto& unused_links = applied ? removed_links : added_links;
+
+    for(auto&& link : unused_links) {
+        delete link;
+    }
+}
+
+bool audio::patch::is_applied()
+{
+    return applied.load();
+}
+
+// the state starts as a copy of what the channel is using right now
+audio::patch::input_state& audio::patch::get_state(audio::input * input_in)
+{
+    auto found = input_states.find(input_in);
+
+    if (found != input_states.end()) {
+        return found->second;
+    }
+
+    auto& state = input_states[input_in];
+    state.links = input_in->links;
+    state.mix_buffer = input_in->mix_buffer;
+
+    return state;
+}
+
+std::vector<audio::link *>& audio::patch::get_links(audio::output * output_in)
+{
+    auto found = output_links.find(output_in);
+
+    if (found != output_links.end()) {
+        return found->second;
+    }
+
+    return output_links[output_in] = output_in->links;
+}
+
+// with the changes already in the patch
+bool audio::patch::has_link(audio::output * from_in, audio::input * to_in)
+{
+    auto& from_links = get_links(from_in);
+
+    return std::find_if(from_links.begin(), from_links.end(), [to_in](audio::link * link_in) { return link_in->to == to_in; }) != from_links.end();
+}
+
+void audio::patch::add_link(audio::output * from_in, audio::input * to_in)
+{
+    auto& from_links = get_links(from_in);
+
+    for(auto&& link : from_links) {
+        if (link->to == to_in) {
+            system_fault("there is already a link from ", from_in->to_string(), " to ", to_in->to_string());
+        }
+    }
+
+    auto new_link = new audio::link(from_in, to_in);
+
+    added_links.push_back(new_link);
+    from_links.push_back(new_link);
+    get_state(to_in).links.push_back(new_link);
+
+    changed_nodes.insert(from_in->get_parent());
+    changed_nodes.insert(to_in->get_parent());
+}
+
+void audio::patch::remove_link(audio::output * from_in, audio::input * to_in)
+{
+    auto& from_links = get_links(from_in);
+    auto& to_links = get_state(to_in).links;
+    auto found = std::find_if(from_links.begin(), from_links.end(), [to_in](audio::link * link_in) { return link_in->to == to_in; });
+
+    if (found == from_links.end()) {
+        system_fault("there is no link from ", from_in->to_string(), " to ", to_in->to_string());
+    }
+
+    auto old_link = *found;
+
+    from_links.erase(found);
+    to_links.erase(std::find(to_links.begin(), to_links.end(), old_link));
+
+    auto added = std::find(added_links.begin(), added_links.end(), old_link);
+
+    if (added != added_links.end()) {
+        added_links.erase(added);
+        delete old_link;
+    } else {
+        removed_links.push_back(old_link);
+    }
+
+    changed_nodes.insert(from_in->get_parent());
+    changed_nodes.insert(to_in->get_parent());
+}
+
+// the node must already be initialized; it is activated and started
+// by the domain before the patch is applied
+void audio::patch::add_node(node::base * node_in)
+{
+    added_nodes.push_back(node_in);
+}
+
+// every link into and out of the node is removed with the node
+void audio::patch::remove_node(node::base * node_in)
+{
+    for(auto&& input : node_in->audio.get_inputs()) {
+        auto links = get_state(input).links;
+
+        for(auto&& link : links) {
+            remove_link(link->from, input);
+        }
+    }
+
+    for(auto&& output : node_in->audio.get_outputs()) {
+        auto links = get_links(output);
+
+        for(auto&& link : links) {
+            remove_link(output, link->to);
+        }
+    }
+
+    removed_nodes.push_back(node_in);
+}
+
+const std::vector<node::base *>& audio::patch::get_added_nodes()
+{
+    return added_nodes;
+}
+
+const std::vector<node::base *>& audio::patch::get_removed_nodes()
+{
+    return removed_nodes;
+}
+
+// every node that has a link added or removed
+const std::set<node::base *>& audio::patch::get_changed_nodes()
+{
+    return changed_nodes;
+}
+
+// a node only runs once a source delivered to one of its inputs so a
+// node left with nothing feeding any input never runs again; if its
+// outputs are still linked or it is an IO node the whole domain would
+// wait for it forever
+string_type audio::patch::get_stall_problem()
+{
+    std::set<node::base *> nodes(changed_nodes);
+
+    nodes.insert(added_nodes.begin(), added_nodes.end());
+
+    for(auto&& node : removed_nodes) {
+        nodes.erase(node);
+    }
+
+    for(auto&& node : nodes) {
+        auto inputs = node->audio.get_inputs();
+
+        if (inputs.size() == 0) {
+            continue;
+        }
+
+        size_type num_sources = 0;
+
+        for(auto&& input : inputs) {
+            auto found = input_states.find(input);
+            auto& links = found == input_states.end() ? input->links : found->second.links;
+
+            num_sources += links.size() + input->num_forwards_to_us;
+        }
+
+        if (num_sources > 0) {
+            continue;
+        }
+
+        if (dynamic_cast<node::io *>(node) != nullptr) {
+            return pulsar::util::to_string("IO node ", node->name, " would have nothing linked to its inputs");
+        }
+
+        for(auto&& output : node->audio.get_outputs()) {
+            auto found = output_links.find(output);
+            auto& links = found == output_links.end() ? output->links : found->second;
+
+            if (links.size() > 0) {
+                return pulsar::util::to_string("node ", node->name, " would have nothing linked to its inputs but its outputs are still linked");
+            }
+        }
+    }
+
+    return "";
+}
+
+// the same sizing input::update_ready_slots() does but into the
+// patch so the input in use is not touched
+void audio::patch::prepare()
+{
+    for(auto&& i : input_states) {
+        auto input = i.first;
+        auto& state = i.second;
+        auto num_slots = state.links.size() + input->num_forwards_to_us;
+
+        state.ready_buffers.assign(num_slots, nullptr);
+
+        if (num_slots > 1 && state.mix_buffer == nullptr) {
+            state.mix_buffer = audio::buffer::make();
+            state.mix_buffer->init(input->get_parent()->get_domain()->buffer_size);
+        }
+    }
+}
+
+// must only be called while no node in the domain is in a cycle
+void audio::patch::apply()
+{
+    assert(! applied);
+
+    for(auto&& i : input_states) {
+        auto input = i.first;
+        auto& state = i.second;
+
+        input->links.swap(state.links);
+        input->ready_buffers.swap(state.ready_buffers);
+        input->mix_buffer.swap(state.mix_buffer);
+    }
+
+    for(auto&& i : output_links) {
+        i.first->links.swap(i.second);
+    }
+
+    // the number of links each input waits for was counted when the
+    // node finished its last cycle
+    for(auto&& node : changed_nodes) {
+        node->audio.reset_cycle();
+    }
+
+    applied.store(true);
+}
+
 audio::component::component(node::base * parent_in)
 : parent(parent_in)
 {
@@ -519,28 +840,30 @@ audio::component::component(node::base * parent_in)
 
 audio::component::~component()
 {
-    for (auto&& i : inputs) {
-        delete i.second;
+    for (auto&& input : input_list) {
+        delete input;
     }
 
-    for(auto&& i : outputs) {
-        delete i.second;
+    for(auto&& output : output_list) {
+        delete output;
     }
 
     inputs.clear();
     outputs.clear();
+    input_list.clear();
+    output_list.clear();
 }
 
 void audio::component::init_cycle()
 {
     log_trace("audio component is starting cycle for node ", parent->name);
 
-    for(auto&& output : outputs) {
-        output.second->init_cycle();
+    for(auto&& output : output_list) {
+        output->init_cycle();
     }
 
-    for(auto&& input : inputs) {
-        input.second->init_cycle();
+    for(auto&& input : input_list) {
+        input->init_cycle();
     }
 }
 
@@ -550,14 +873,14 @@ void audio::component::reset_cycle()
 
     pulsar::size_type inputs_with_links = 0;
 
-    for(auto&& output : outputs) {
-        output.second->reset_cycle();
+    for(auto&& output : output_list) {
+        output->reset_cycle();
     }
 
-    for(auto&& input : inputs) {
-        input.second->reset_cycle();
+    for(auto&& input : input_list) {
+        input->reset_cycle();
 
-        if (input.second->get_links_waiting() > 0) {
+        if (input->get_links_waiting() > 0) {
             inputs_with_links++;
         }
     }
@@ -576,12 +899,16 @@ bool audio::component::is_ready()
 }
 
 void audio::component::activate()
-{ }
+{
+    for(auto&& output : output_list) {
+        output->activate();
+    }
+}
 
 void audio::component::notify()
 {
-    for (auto&& output : outputs) {
-        output.second->notify();
+    for (auto&& output : output_list) {
+        output->notify();
     }
 }
 
@@ -611,6 +938,7 @@ audio::input * audio::component::add_input(const string_type& name_in)
 
     auto new_input = new audio::input(name_in, parent);
     inputs[new_input->name] = new_input;
+    input_list.push_back(new_input);
 
     auto property_name = string_type("input:") + name_in;
     parent->add_property(property_name, property::value_type::string).value->set("audio");
@@ -620,11 +948,35 @@ audio::input * audio::component::add_input(const string_type& name_in)
 
 audio::input * audio::component::get_input(const string_type& name_in)
 {
-    if (inputs.count(name_in) == 0) {
+    auto input = find_input(name_in);
+
+    if (input == nullptr) {
         system_fault("could not find input channel named ", name_in, " for node ", parent->name);
     }
 
-    return inputs[name_in];
+    return input;
+}
+
+audio::input * audio::component::find_input(const string_type& name_in)
+{
+    auto found = inputs.find(name_in);
+    return found == inputs.end() ? nullptr : found->second;
+}
+
+audio::input * audio::component::get_input(const size_type index_in)
+{
+    assert(index_in < input_list.size());
+    return input_list[index_in];
+}
+
+pulsar::size_type audio::component::get_num_inputs()
+{
+    return input_list.size();
+}
+
+pulsar::util::span<audio::input *> audio::component::get_inputs()
+{
+    return input_list;
 }
 
 std::vector<string_type> audio::component::get_input_names()
@@ -646,6 +998,7 @@ audio::output * audio::component::add_output(const string_type& name_in)
 
     auto new_output = new audio::output(name_in, parent);
     outputs[new_output->name] = new_output;
+    output_list.push_back(new_output);
 
     auto property_name = string_type("output:") + name_in;
     parent->add_property(property_name, property::value_type::string).value->set("audio");
@@ -655,11 +1008,35 @@ audio::output * audio::component::add_output(const string_type& name_in)
 
 audio::output * audio::component::get_output(const string_type& name_in)
 {
-    if (outputs.count(name_in) == 0) {
+    auto output = find_output(name_in);
+
+    if (output == nullptr) {
         system_fault("could not find output channel named ", name_in, " for node ", parent->name);
     }
 
-    return outputs[name_in];
+    return output;
+}
+
+audio::output * audio::component::find_output(const string_type& name_in)
+{
+    auto found = outputs.find(name_in);
+    return found == outputs.end() ? nullptr : found->second;
+}
+
+audio::output * audio::component::get_output(const size_type index_in)
+{
+    assert(index_in < output_list.size());
+    return output_list[index_in];
+}
+
+pulsar::size_type audio::component::get_num_outputs()
+{
+    return output_list.size();
+}
+
+pulsar::util::span<audio::output *> audio::component::get_outputs()
+{
+    return output_list;
 }
 
 std::vector<string_type> audio::component::get_output_names()
@@ -18,11 +18,13 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <vector>
 
 #include <pulsar/node.forward.h>
 #include <pulsar/system.h>
 #include <pulsar/thread.h>
+#include <pulsar/util.h>
 
 namespace pulsar {
 
@@ -33,6 +35,7 @@ struct input_forward;
 struct link;
 class output;
 struct output_forward;
+class patch;
 
 class buffer {
     pulsar::size_type size = 0;
@@ -42,6 +45,7 @@ class buffer {
     public:
     ~buffer();
     void init(const pulsar::size_type buffer_size_in, pulsar::sample_type * pointer_in = nullptr);
+    void wrap(const pulsar::size_type buffer_size_in, pulsar::sample_type * pointer_in);
     template <typename... Args>
     static std::shared_ptr<buffer> make(Args&&... args)
     {
@@ -55,13 +59,17 @@ class buffer {
     pulsar::size_type get_size();
     pulsar::sample_type * get_pointer();
     void zero();
+    void mix(buffer * mix_from_in);
     void mix(std::shared_ptr<buffer> mix_from_in);
     void set(sample_type * pointer_in, const size_type size_in);
+    void set(buffer * buffer_in);
     void set(std::shared_ptr<buffer> buffer_in);
     void scale(const float scale_in);
 };
 
 class channel {
+    friend patch;
+
     protected:
     node::base * parent;
     std::vector<link *> links;
@@ -72,17 +80,25 @@ class channel {
     virtual ~channel();
     virtual void init_cycle() = 0;
     virtual void reset_cycle() = 0;
-    void register_link(link * link_in);
+    virtual void register_link(link * link_in);
     node::base * get_parent();
+    const std::vector<link *>& get_links();
     virtual const string_type to_string() = 0;
 };
 
 class input : public channel {
+    friend patch;
+
     std::atomic<pulsar::size_type> links_waiting = ATOMIC_VAR_INIT(0);
     std::atomic<size_type> num_forwards_to_us = ATOMIC_VAR_INIT(0);
     std::vector<input_forward *> forwards;
-    std::map<link *, std::shared_ptr<audio::buffer>> link_buffers;
-    mutex_type link_buffers_mutex;
+    // one slot for every link and forward that delivers a buffer
+    // to this input; slots are claimed with ready_count so no lock
+    // is needed and the vector never changes size during a cycle
+    std::vector<audio::buffer *> ready_buffers;
+    std::atomic<size_type> ready_count = ATOMIC_VAR_INIT(0);
+    std::shared_ptr<audio::buffer> mix_buffer;
+    void update_ready_slots();
 
     public:
     virtual void init_cycle() override;
@@ -93,22 +109,31 @@ class input : public channel {
     void link_to(node::base * node_in, const string_type& port_name_in);
     void forward_to(input * to_in);
     void forward_to(node::base * node_in, const string_type& port_name_in);
+    virtual void register_link(link * link_in) override;
     void register_forward(input_forward * forward_in);
-    std::shared_ptr<audio::buffer> get_buffer();
-    std::shared_ptr<audio::buffer> mix_outputs();
-    void link_ready(audio::link * link_in, std::shared_ptr<audio::buffer> buffer_in);
+    audio::buffer * get_buffer();
+    audio::buffer * mix_outputs();
+    void link_ready(audio::link * link_in, audio::buffer * buffer_in);
     virtual const string_type to_string() override;
 };
 
 class output : public channel {
+    friend patch;
+
     std::vector<output_forward *> forwards;
     size_type forwards_to_us = 0;
-    std::shared_ptr<audio::buffer> buffer;
-    std::vector<std::shared_ptr<audio::buffer>> forwarded_buffers;
+    // the buffers are owned by the output for its whole life and the
+    // pointer to the one in use is all that moves through the cycle
+    std::shared_ptr<audio::buffer> own_buffer;
+    std::shared_ptr<audio::buffer> external_buffer;
+    audio::buffer * buffer = nullptr;
+    std::vector<audio::buffer *> forwarded_buffers;
     mutex_type forward_mutex;
+    void notify(audio::buffer * buffer_in);
 
     public:
     output(const string_type& name_in, node::base * parent_in);
+    void activate();
     virtual void init_cycle() override;
     virtual void reset_cycle() override;
     void link_to(input * to_in);
@@ -116,9 +141,10 @@ class output : public channel {
     void forward_to(output * to_in);
     void forward_to(node::base * node_in, const string_type& port_name_in);
     void register_forward(output_forward * forward_in);
-    void add_forwarded_buffer(std::shared_ptr<audio::buffer> buffer_in);
-    std::shared_ptr<audio::buffer> get_buffer();
-    void set_buffer(std::shared_ptr<audio::buffer> buffer_in);
+    void add_forwarded_buffer(audio::buffer * buffer_in);
+    audio::buffer * get_buffer();
+    void set_buffer(audio::buffer * buffer_in);
+    void set_external_buffer(sample_type * pointer_in);
     void notify();
     virtual const string_type to_string() override;
 };
@@ -133,7 +159,7 @@ struct link {
     output * from;
     input * to;
     link(output * from_in, input * to_in);
-    void notify(std::shared_ptr<audio::buffer> ready_buffer_in, const bool blocking_in = true);
+    void notify(audio::buffer * ready_buffer_in, const bool blocking_in = true);
     void reset();
     const string_type to_string();
 };
@@ -151,12 +177,55 @@ struct output_forward {
     void set_buffer();
 };
 
+// a change to the links between nodes; everything that needs memory
+// is set up by the control thread and apply() only swaps the new link
+// lists in so it can run between two cycles on the audio thread. The
+// old lists and the removed links stay in the patch and are freed
+// along with it on the control thread.
+class patch {
+    struct input_state {
+        std::vector<link *> links;
+        std::vector<audio::buffer *> ready_buffers;
+        std::shared_ptr<audio::buffer> mix_buffer;
+    };
+
+    std::map<input *, input_state> input_states;
+    std::map<output *, std::vector<link *>> output_links;
+    std::vector<link *> added_links;
+    std::vector<link *> removed_links;
+    std::set<node::base *> changed_nodes;
+    std::vector<node::base *> added_nodes;
+    std::vector<node::base *> removed_nodes;
+    std::atomic<bool> applied = ATOMIC_VAR_INIT(false);
+    input_state& get_state(input * input_in);
+    std::vector<link *>& get_links(output * output_in);
+
+    public:
+    ~patch();
+    bool is_applied();
+    bool has_link(output * from_in, input * to_in);
+    void add_link(output * from_in, input * to_in);
+    void remove_link(output * from_in, input * to_in);
+    void add_node(node::base * node_in);
+    void remove_node(node::base * node_in);
+    const std::vector<node::base *>& get_added_nodes();
+    const std::vector<node::base *>& get_removed_nodes();
+    const std::set<node::base *>& get_changed_nodes();
+    string_type get_stall_problem();
+    void prepare();
+    void apply();
+};
+
 class component {
     friend node::base;
 
     node::base * parent = nullptr;
     std::map<string_type, audio::input *> inputs;
     std::map<string_type, audio::output *> outputs;
+    // the same channels in the order they were added so the cycle
+    // can walk them without touching the maps
+    std::vector<audio::input *> input_list;
+    std::vector<audio::output *> output_list;
     std::atomic<pulsar::size_type> inputs_waiting = ATOMIC_VAR_INIT(0);
 
     public:
@@ -171,9 +240,17 @@ class component {
     pulsar::size_type get_inputs_waiting();
     audio::input * add_input(const string_type& name_in);
     audio::input * get_input(const string_type& name_in);
+    audio::input * find_input(const string_type& name_in);
+    audio::input * get_input(const size_type index_in);
+    size_type get_num_inputs();
+    pulsar::util::span<audio::input *> get_inputs();
     std::vector<string_type> get_input_names();
     audio::output * add_output(const string_type& name_in);
     audio::output * get_output(const string_type& name_out);
+    audio::output * find_output(const string_type& name_in);
+    audio::output * get_output(const size_type index_in);
+    size_type get_num_outputs();
+    pulsar::util::span<audio::output *> get_outputs();
     std::vector<string_type> get_output_names();
 };
 
@@ -12,11 +12,15 @@
 // GNU Lesser General Public License for more details.
 
 #include <cassert>
+#include <cmath>
+#include <set>
 
 #include <pulsar/config.h>
+#include <pulsar/config.graph.h>
 #include <pulsar/domain.h>
 #include <pulsar/library.h>
 #include <pulsar/logging.h>
+#include <pulsar/node.h>
 #include <pulsar/system.h>
 #include <pulsar/util.h>
 
@@ -25,9 +29,84 @@ namespace pulsar {
 namespace config {
 
 using node_map_type = std::map<string_type, node::base *>;
+using link_list_type = std::vector<std::pair<audio::output *, audio::input *>>;
 
 static pulsar::node::base * make_node(const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in);
 
+// the nodes are recorded by their position in the graph and go ahead
+// of the rest of the numbers
+static void record(std::shared_ptr<pulsar::config::domain> config_in, const op_type type_in, const std::vector<node::base *>& nodes_in, std::vector<size_type> numbers_in = {}, const std::vector<string_type>& strings_in = {}, const std::vector<double>& reals_in = {})
+{
+    auto recorder = config_in->get_recorder();
+
+    if (recorder == nullptr) {
+        return;
+    }
+
+    std::vector<size_type> numbers;
+
+    for(auto&& i : nodes_in) {
+        numbers.push_back(recorder->get_index(i));
+    }
+
+    numbers.insert(numbers.end(), numbers_in.begin(), numbers_in.end());
+    recorder->add_op({ type_in, numbers, strings_in, reals_in });
+}
+
+template <typename T>
+static size_type channel_index(const util::span<T *>& channels_in, const T * channel_in)
+{
+    for(size_type i = 0; i < channels_in.size(); i++) {
+        if (channels_in[i] == channel_in) {
+            return i;
+        }
+    }
+
+    system_fault("could not find channel ", channel_in->name);
+}
+
+static void record_property(std::shared_ptr<pulsar::config::domain> config_in, node::base * node_in, const string_type& name_in, const YAML::Node& value_in)
+{
+    if (value_in.IsScalar()) {
+        record(config_in, op_type::set_property, { node_in }, { 0 }, { name_in, value_in.Scalar() });
+    } else {
+        record(config_in, op_type::set_property, { node_in }, { 1 }, { name_in, YAML::Dump(value_in) });
+    }
+}
+
+// smoothing is either the time in milliseconds for a linear ramp
+// or a map with type and time_ms
+static property::smoothing parse_smoothing(const YAML::Node& smoothing_in, const pulsar::size_type sample_rate_in)
+{
+    property::smoothing retval;
+    real_type time_ms = 0;
+
+    if (smoothing_in.IsScalar()) {
+        retval.type = property::smoothing_type::linear;
+        time_ms = smoothing_in.as<real_type>();
+    } else if (smoothing_in.IsMap()) {
+        retval.type = property::smoothing_type::linear;
+
+        if (smoothing_in["type"]) {
+            retval.type = property::smoothing_type_from_name(smoothing_in["type"].as<string_type>());
+        }
+
+        if (smoothing_in["time_ms"]) {
+            time_ms = smoothing_in["time_ms"].as<real_type>();
+        }
+    } else {
+        system_fault("smoothing must be a number or a map");
+    }
+
+    retval.length = time_ms * sample_rate_in / 1000;
+
+    if (retval.length == 0) {
+        retval.type = property::smoothing_type::none;
+    }
+
+    return retval;
+}
+
 std::shared_ptr<pulsar::domain> make_domain(std::shared_ptr<pulsar::config::domain> domain_info_in)
 {
     auto domain_config = domain_info_in->get_config();
@@ -39,6 +118,20 @@ std::shared_ptr<pulsar::domain> make_domain(std::shared_ptr<pulsar::config::doma
     auto domain_buffer_size = domain_config["buffer_size"].as<pulsar::size_type>();
 
     auto domain = pulsar::domain::make(domain_info_in->name, domain_sample_rate, domain_buffer_size);
+    auto smoothing_node = domain_config["smoothing"];
+
+    if (smoothing_node) {
+        domain->default_smoothing = parse_smoothing(smoothing_node, domain_sample_rate);
+
+        if (smoothing_node.IsMap() && smoothing_node["block_size"]) {
+            domain->smoothing_block_size = smoothing_node["block_size"].as<pulsar::size_type>();
+
+            if (domain->smoothing_block_size == 0) {
+                system_fault("smoothing block size can not be 0");
+            }
+        }
+    }
+
     return domain;
 }
 
@@ -80,22 +173,26 @@ static void apply_yaml_template(YAML::Node& dest_in, const YAML::Node& src_in)
     }
 }
 
-static void link_node_n_to_n(node::base * source_node_in, node::base * sink_node_in)
+// the find_links functions return why the links could not be found
+// so a reload can refuse a config with a bad link instead of faulting
+static string_type find_links_n_to_n(node::base * source_node_in, node::base * sink_node_in, link_list_type& links_out)
 {
     auto output_names = source_node_in->audio.get_output_names();
     auto input_names = sink_node_in->audio.get_input_names();
     auto num_outputs = output_names.size();
 
     if (input_names.size() != num_outputs) {
-        system_fault("number of inputs and outputs was not the same");
+        return util::to_string("number of inputs and outputs was not the same linking ", source_node_in->name, " to ", sink_node_in->name);
     }
 
     for(size_type i = 0; i < num_outputs; i++) {
-        source_node_in->audio.get_output(output_names[i])->link_to(sink_node_in, input_names[i]);
+        links_out.emplace_back(source_node_in->audio.get_output(output_names[i]), sink_node_in->audio.get_input(input_names[i]));
     }
+
+    return "";
 }
 
-static void link_channel_by_target(audio::output * source_channel_in, const node_map_type& node_map_in, const string_type& target_string_in) {
+static string_type find_links_by_target(audio::output * source_channel_in, const node_map_type& node_map_in, const string_type& target_string_in, link_list_type& links_out) {
     auto target_split = util::split(target_string_in, ':');
     auto split_size = target_split.size();
     string_type sink_node_name, sink_channel_name;
@@ -105,7 +202,7 @@ static void link_channel_by_target(audio::output * source_channel_in, const node
         sink_node_name = target_split[0];
         auto found = node_map_in.find(sink_node_name);
         if (found == node_map_in.end()) {
-            system_fault("could not find a node named ", sink_node_name);
+            return util::to_string("could not find a node named ", sink_node_name);
         }
         sink_node = found->second;
         sink_channel_name = target_split[1];
@@ -113,64 +210,124 @@ static void link_channel_by_target(audio::output * source_channel_in, const node
         sink_node_name = target_string_in;
         auto found = node_map_in.find(sink_node_name);
         if (found == node_map_in.end()) {
-            system_fault("could not find a node named ", sink_node_name);
+            return util::to_string("could not find a node named ", sink_node_name);
         }
         sink_node = found->second;
         auto sink_node_inputs = sink_node->audio.get_input_names();
 
         if (sink_node_inputs.size() != 1) {
-            system_fault("no input channel was specified and target node has more than 1 input");
+            return util::to_string("no input channel was specified and target node ", sink_node_name, " has more than 1 input");
         }
 
         sink_channel_name = sink_node_inputs[0];
 
     } else {
-        system_fault("invalid connection string specified: ", target_string_in);
+        return util::to_string("invalid connection string specified: ", target_string_in);
     }
 
-    source_channel_in->link_to(sink_node, sink_channel_name);
+    if (sink_channel_name == "*") {
+        for(auto&& input : sink_node->audio.get_inputs()) {
+            links_out.emplace_back(source_channel_in, input);
+        }
+    } else {
+        auto sink_channel = sink_node->audio.find_input(sink_channel_name);
+
+        if (sink_channel == nullptr) {
+            return util::to_string("could not find input channel named ", sink_channel_name, " for node ", sink_node_name);
+        }
+
+        links_out.emplace_back(source_channel_in, sink_channel);
+    }
+
+    return "";
 }
 
-static void connect_nodes(node_map_type& node_map_in, const YAML::Node& node_yaml_in)
+// the links a node asks for in its link section
+static string_type find_links(const node_map_type& node_map_in, const YAML::Node& node_yaml_in, link_list_type& links_out)
 {
-    auto node_yaml = node_yaml_in;
-    auto node_name = node_yaml["name"].as<string_type>();
-    auto source_node = node_map_in[node_name];
-    auto links = node_yaml["link"];
-    auto forwards = node_yaml["forward"];
+    auto node_name = node_yaml_in["name"].as<string_type>();
+    auto links = node_yaml_in["link"];
 
-    if (links) {
-        // if the number of inputs and outputs is the same
-        // connect them together in order
-        if (links.IsScalar()) {
-            auto sink_node_name = links.as<string_type>();
+    if (! links) {
+        return "";
+    }
 
-            if (node_map_in.find(sink_node_name) == node_map_in.end()) {
-                system_fault("could not find a node named ", sink_node_name);
-            }
+    auto found = node_map_in.find(node_name);
 
-            auto sink_node = node_map_in[sink_node_name];
-            link_node_n_to_n(source_node, sink_node);
-        } else {
-            for(auto&& i : links) {
-                auto source_channel_string = i.first.as<string_type>();
-                auto source_channel = source_node->audio.get_output(source_channel_string);
-                auto target_yaml = i.second;
+    if (found == node_map_in.end()) {
+        return util::to_string("could not find a node named ", node_name);
+    }
 
-                if (target_yaml.IsSequence()) {
-                    auto seq_size = target_yaml.size();
+    auto source_node = found->second;
 
-                    for(size_type i = 0; i < seq_size; i++) {
-                        auto target_string = target_yaml[i].as<string_type>();
-                        link_channel_by_target(source_channel, node_map_in, target_string);
-                    }
+    // if the number of inputs and outputs is the same
+    // connect them together in order
+    if (links.IsScalar()) {
+        auto sink_node_name = links.as<string_type>();
+        auto sink_node = node_map_in.find(sink_node_name);
 
-                } else {
-                    auto target_string = i.second.as<string_type>();
-                    link_channel_by_target(source_channel, node_map_in, target_string);
-                }
+        if (sink_node == node_map_in.end()) {
+            return util::to_string("could not find a node named ", sink_node_name);
+        }
+
+        return find_links_n_to_n(source_node, sink_node->second, links_out);
+    }
+
+    if (! links.IsMap()) {
+        return util::to_string("the link section of node ", node_name, " must be a node name or a map");
+    }
+
+    for(auto&& i : links) {
+        auto source_channel_string = i.first.as<string_type>();
+        auto source_channel = source_node->audio.find_output(source_channel_string);
+        auto target_yaml = i.second;
+        string_type problem;
+
+        if (source_channel == nullptr) {
+            return util::to_string("could not find output channel named ", source_channel_string, " for node ", node_name);
+        }
+
+        if (target_yaml.IsSequence()) {
+            auto seq_size = target_yaml.size();
+
+            for(size_type i = 0; i < seq_size && problem == ""; i++) {
+                auto target_string = target_yaml[i].as<string_type>();
+                problem = find_links_by_target(source_channel, node_map_in, target_string, links_out);
             }
+
+        } else {
+            auto target_string = i.second.as<string_type>();
+            problem = find_links_by_target(source_channel, node_map_in, target_string, links_out);
         }
+
+        if (problem != "") {
+            return problem;
+        }
+    }
+
+    return "";
+}
+
+static void connect_nodes(node_map_type& node_map_in, const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in)
+{
+    auto node_yaml = node_yaml_in;
+    auto node_name = node_yaml["name"].as<string_type>();
+    auto source_node = node_map_in[node_name];
+    auto forwards = node_yaml["forward"];
+    link_list_type links;
+
+    auto problem = find_links(node_map_in, node_yaml, links);
+
+    if (problem != "") {
+        system_fault(problem);
+    }
+
+    for(auto&& i : links) {
+        auto from_node = i.first->get_parent();
+        auto to_node = i.second->get_parent();
+
+        record(config_in, op_type::link, { from_node, to_node }, { channel_index(from_node->audio.get_outputs(), i.first), channel_index(to_node->audio.get_inputs(), i.second) });
+        i.first->link_to(i.second);
     }
 
     if (forwards) {
@@ -183,49 +340,84 @@ static void connect_nodes(node_map_type& node_map_in, const YAML::Node& node_yam
             auto to_parts = util::split(target_string, ':');
             auto target_node = node_map_in[to_parts[0]];
             // auto target_port = target_node->audio.get_output(to_parts[1]);
+            record(config_in, op_type::forward_output, { source_node, target_node }, {}, { from_port_string, to_parts[1] });
             from_port->forward_to(target_node, to_parts[1]);
         }
     }
 }
 
-static pulsar::node::base * make_class_node(const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::domain> domain_in)
+// the names in the section get the prefix to make the property name
+static void set_properties(node::base * node_in, const YAML::Node& section_in, const string_type& prefix_in, std::shared_ptr<pulsar::config::domain> config_in)
+{
+    for(auto&& i : section_in) {
+        auto property_name = prefix_in + i.first.as<string_type>();
+        record_property(config_in, node_in, property_name, i.second);
+        node_in->get_property(property_name).value->set(i.second);
+    }
+}
+
+// a class node is made in three steps so make_nodes() can init() the
+// nodes together; everything that touches the YAML is done before or
+// after init() on the thread that called make_nodes()
+static pulsar::node::base * create_class_node(const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in)
 {
     auto node_yaml = node_yaml_in;
     auto node_name_node = node_yaml["name"];
     auto node_name = node_name_node.as<string_type>();
     auto class_name_node = node_yaml["class"];
     auto class_name = class_name_node.as<string_type>();
-
-    auto node_config_node = node_yaml["config"];
     auto node_plugin_node = node_yaml["plugin"];
-    auto node_inputs_node = node_yaml["sends"];
-    auto node_outputs_node = node_yaml["receives"];
 
     auto new_node = pulsar::library::make_node(class_name, node_name, domain_in);
+    auto recorder = config_in->get_recorder();
+
+    if (recorder != nullptr) {
+        recorder->add_op({ op_type::make_node, {}, { class_name, node_name }, {} });
+        recorder->add_node(new_node);
+    }
 
     if (node_plugin_node) {
-        for(auto&& i : node_plugin_node) {
-            auto config_name = i.first.as<string_type>();
-            auto config_node = i.second;
-            auto property_name = string_type("plugin:") + config_name;
-            new_node->get_property(property_name).value->set(config_node);
-        }
+        set_properties(new_node, node_plugin_node, "plugin:", config_in);
     }
 
-    new_node->init();
+    return new_node;
+}
+
+static void configure_class_node(node::base * new_node, const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in)
+{
+    auto node_yaml = node_yaml_in;
+    auto node_config_node = node_yaml["config"];
+    auto node_smoothing_node = node_yaml["smoothing"];
+    auto node_inputs_node = node_yaml["sends"];
+    auto node_outputs_node = node_yaml["receives"];
 
     if (node_config_node) {
-        for(auto&& i : node_config_node) {
-            auto config_name = i.first.as<string_type>();
-            auto config_node = i.second;
-            auto property_name = string_type("config:") + config_name;
-            new_node->get_property(property_name).value->set(config_node);
+        set_properties(new_node, node_config_node, "config:", config_in);
+    }
+
+    if (domain_in->default_smoothing.type != property::smoothing_type::none) {
+        for(auto&& property : new_node->get_property_list()) {
+            if (property->name.find("config:") == 0 && property->value->type == property::value_type::real) {
+                auto& smoothing = domain_in->default_smoothing;
+                record(config_in, op_type::set_smoothing, { new_node }, { static_cast<size_type>(smoothing.type), smoothing.length }, { property->name });
+                property->value->set_smoothing(smoothing);
+            }
+        }
+    }
+
+    if (node_smoothing_node) {
+        for(auto&& i : node_smoothing_node) {
+            auto property_name = string_type("config:") + i.first.as<string_type>();
+            auto smoothing = parse_smoothing(i.second, domain_in->sample_rate);
+            record(config_in, op_type::set_smoothing, { new_node }, { static_cast<size_type>(smoothing.type), smoothing.length }, { property_name });
+            new_node->get_property(property_name).value->set_smoothing(smoothing);
         }
     }
 
     if (node_inputs_node) {
         for(auto&& i : node_inputs_node) {
             auto input_name = i.as<string_type>();
+            record(config_in, op_type::add_input, { new_node }, {}, { input_name });
             new_node->audio.add_input(input_name);
         }
     }
@@ -233,9 +425,20 @@ static pulsar::node::base * make_class_node(const YAML::Node& node_yaml_in, std:
     if (node_outputs_node) {
         for(auto&& i : node_outputs_node) {
             auto output_name = i.as<string_type>();
+            record(config_in, op_type::add_output, { new_node }, {}, { output_name });
             new_node->audio.add_output(output_name);
         }
     }
+}
+
+static pulsar::node::base * make_class_node(const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in)
+{
+    auto new_node = create_class_node(node_yaml_in, config_in, domain_in);
+
+    record(config_in, op_type::init_node, { new_node });
+    new_node->init();
+
+    configure_class_node(new_node, node_yaml_in, config_in, domain_in);
 
     return new_node;
 }
@@ -281,7 +484,7 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
 
     node_yaml["class"] = "pulsar::node::chain";
 
-    auto chain_root_node = make_class_node(node_yaml_in, domain_in);
+    auto chain_root_node = make_class_node(node_yaml_in, config_in, domain_in);
 
     if (chain_outputs_node) {
         if (! chain_outputs_node.IsSequence()) {
@@ -290,6 +493,7 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
 
         for(size_type i = 0; i < chain_outputs_node.size(); i++) {
             auto output_name = chain_outputs_node[i].as<string_type>();
+            record(config_in, op_type::add_output, { chain_root_node }, {}, { output_name });
             chain_root_node->audio.add_output(output_name);
         }
     }
@@ -301,6 +505,7 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
 
         for(size_type i = 0; i < chain_inputs_node.size(); i++) {
             auto input_name = chain_inputs_node[i].as<string_type>();
+            record(config_in, op_type::add_input, { chain_root_node }, {}, { input_name });
             chain_root_node->audio.add_input(input_name);
         }
     }
@@ -317,6 +522,8 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
             auto input_name = "in_" + channel_number;
             auto output_name = "out_" + channel_number;
 
+            record(config_in, op_type::add_input, { chain_root_node }, {}, { input_name });
+            record(config_in, op_type::add_output, { chain_root_node }, {}, { output_name });
             chain_root_node->audio.add_input(input_name);
             chain_root_node->audio.add_output(output_name);
         }
@@ -347,6 +554,7 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
                 auto target_string = target_node[i].as<string_type>();
                 auto target_parts = util::split(target_string, ':');
                 auto target_node = chain_nodes[target_parts[0]];
+                record(config_in, op_type::forward_input, { chain_root_node, target_node }, {}, { output_name, target_parts[1] });
                 chain_root_node->audio.get_input(output_name)->forward_to(target_node, target_parts[1]);
             }
         } else {
@@ -370,6 +578,7 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
             if (target_property_name != "*") {
                 target_property_name = "state:" + target_property_name;
                 auto& property = target_node->get_property(target_property_name);
+                record(config_in, op_type::share_property, { chain_root_node, target_node }, {}, { target_property_name });
                 chain_root_node->add_property(target_property_name, property);
             } else {
                 for(auto&& i : target_node->get_properties()) {
@@ -381,6 +590,7 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
                         continue;
                     }
 
+                    record(config_in, op_type::share_property, { chain_root_node, target_node }, {}, { property_name });
                     chain_root_node->add_property(property_name, i.second);
                 }
             }
@@ -403,6 +613,7 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
             if (target_property_name != "*") {
                 target_property_name = "config:" + target_property_name;
                 auto& property = target_node->get_property(target_property_name);
+                record(config_in, op_type::share_property, { chain_root_node, target_node }, {}, { target_property_name });
                 chain_root_node->add_property(target_property_name, property);
             } else {
                 for(auto&& i : target_node->get_properties()) {
@@ -414,6 +625,7 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
                         continue;
                     }
 
+                    record(config_in, op_type::share_property, { chain_root_node, target_node }, {}, { property_name });
                     chain_root_node->add_property(property_name, i.second);
                 }
             }
@@ -421,35 +633,42 @@ pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML:
     }
 
     for(size_type i = 0; i < nodes_node.size(); i++) {
-        connect_nodes(chain_nodes, nodes_node[i]);
+        connect_nodes(chain_nodes, nodes_node[i], config_in);
     }
 
     return chain_root_node;
 }
 
-static pulsar::node::base * make_node(const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in)
+// the template is merged into the node definition in place so the
+// link section of a template is seen when the nodes are connected
+static string_type apply_node_template(YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in)
 {
-    node::base * new_node = nullptr;
-    auto node_yaml = node_yaml_in;
-    auto template_node = node_yaml["template"];
+    auto template_node = node_yaml_in["template"];
 
     if (template_node) {
         assert(template_node.IsScalar());
 
         auto template_name = template_node.as<string_type>();
         auto template_src = config_in->get_parent()->get_template(template_name);
-        apply_yaml_template(node_yaml, template_src);
+        apply_yaml_template(node_yaml_in, template_src);
     }
 
     // check for the name after applying the template so
     // the template might provide one
-    auto node_name_node = node_yaml["name"];
+    auto node_name_node = node_yaml_in["name"];
 
     if (! node_name_node) {
         system_fault("node configuration did not include a name");
     }
 
-    auto node_name = node_name_node.as<string_type>();
+    return node_name_node.as<string_type>();
+}
+
+static pulsar::node::base * make_node(const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in)
+{
+    node::base * new_node = nullptr;
+    auto node_yaml = node_yaml_in;
+    auto node_name = apply_node_template(node_yaml, config_in);
 
     auto class_name_node = node_yaml["class"];
     auto chain_name_node = node_yaml["chain"];
@@ -457,7 +676,7 @@ static pulsar::node::base * make_node(const YAML::Node& node_yaml_in, std::share
     if (class_name_node && chain_name_node) {
         system_fault("specify class or chain name but not both; node = ", node_name);
     } else if (class_name_node) {
-        new_node = make_class_node(node_yaml, domain_in);
+        new_node = make_class_node(node_yaml, config_in, domain_in);
     } else if (chain_name_node) {
         auto chain_name = chain_name_node.as<string_type>();
         auto chain_node = config_in->get_parent()->get_chain(chain_name);
@@ -470,38 +689,687 @@ static pulsar::node::base * make_node(const YAML::Node& node_yaml_in, std::share
     return new_node;
 }
 
+// names are the node name and property name separated by the first :
+// and a property name without a prefix is a config: property
+static property::storage * find_binding_storage(const node_map_type& node_map_in, const string_type& name_in, node::base *& node_out, string_type& property_out)
+{
+    auto separator = name_in.find(':');
+
+    if (separator == string_type::npos) {
+        system_fault("binding property did not include a node name: ", name_in);
+    }
+
+    auto node_name = name_in.substr(0, separator);
+    auto found = node_map_in.find(node_name);
+
+    if (found == node_map_in.end()) {
+        system_fault("binding refers to unknown node: ", node_name);
+    }
+
+    auto property_name = pulsar::node::fully_qualify_property_name(name_in.substr(separator + 1));
+    auto storage = found->second->get_property(property_name).value.get();
+
+    if (storage->type == property::value_type::string) {
+        system_fault("bindings can not use string property: ", name_in);
+    }
+
+    node_out = found->second;
+    property_out = property_name;
+
+    return storage;
+}
+
+static void make_binding(const node_map_type& node_map_in, const YAML::Node& binding_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in)
+{
+    property::binding binding;
+    node::base * source_node = nullptr;
+    node::base * target_node = nullptr;
+    string_type source_property, target_property;
+
+    if (! binding_yaml_in["source"] || ! binding_yaml_in["target"]) {
+        system_fault("bindings must have a source and a target");
+    }
+
+    binding.source = find_binding_storage(node_map_in, binding_yaml_in["source"].as<string_type>(), source_node, source_property);
+    binding.target = find_binding_storage(node_map_in, binding_yaml_in["target"].as<string_type>(), target_node, target_property);
+
+    if (binding_yaml_in["convert"]) binding.convert = property::conversion_from_name(binding_yaml_in["convert"].as<string_type>());
+    if (binding_yaml_in["scale"]) binding.scale = binding_yaml_in["scale"].as<real_type>();
+    if (binding_yaml_in["offset"]) binding.offset = binding_yaml_in["offset"].as<real_type>();
+    if (binding_yaml_in["min"]) binding.min = binding_yaml_in["min"].as<real_type>();
+    if (binding_yaml_in["max"]) binding.max = binding_yaml_in["max"].as<real_type>();
+
+    // a one pole filter that gets about 63% of the way to a new value
+    // in the given time
+    if (binding_yaml_in["smoothing"]) {
+        auto time_ms = binding_yaml_in["smoothing"].as<real_type>();
+
+        if (time_ms > 0) {
+            auto cycles = time_ms * domain_in->sample_rate / 1000 / domain_in->buffer_size;
+            binding.smoothing_coefficient = 1 - std::exp(-1 / cycles);
+        }
+    }
+
+    record(
+        config_in, op_type::add_binding, { source_node, target_node }, { static_cast<size_type>(binding.convert) },
+        { source_property, target_property }, { binding.scale, binding.offset, binding.min, binding.max, binding.smoothing_coefficient }
+    );
+
+    domain_in->add_binding(binding);
+}
+
+static std::map<string_type, std::map<string_type, string_type>> get_preset_values(std::shared_ptr<pulsar::config::domain> config_in)
+{
+    std::map<string_type, std::map<string_type, string_type>> retval;
+    auto presets = config_in->get_presets();
+
+    if (! presets) {
+        return retval;
+    }
+
+    if (! presets.IsMap()) {
+        system_fault("presets section must be a map");
+    }
+
+    for (auto&& preset : presets) {
+        retval[preset.first.as<string_type>()] = preset.second.as<std::map<string_type, string_type>>();
+    }
+
+    return retval;
+}
+
+static void add_presets(std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in)
+{
+    for (auto&& preset : get_preset_values(config_in)) {
+        std::vector<string_type> strings = { preset.first };
+
+        for (auto&& i : preset.second) {
+            strings.push_back(i.first);
+            strings.push_back(i.second);
+        }
+
+        record(config_in, op_type::add_preset, {}, {}, strings);
+        domain_in->add_preset(preset.first, preset.second);
+    }
+}
+
+// plugins are loaded and instantiated when a node is initialized so the
+// class nodes at the top of the domain are initialized together; chains
+// are made one at a time and the nodes are linked in the order they
+// are listed so the result does not depend on how the threads ran
 std::map<string_type, pulsar::node::base *> make_nodes(std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in) {
     auto node_map = std::map<string_type, pulsar::node::base *>();
+    std::vector<std::pair<node::base *, YAML::Node>> class_nodes;
+    std::vector<node::base *> new_nodes;
+    util::stopwatch phase_time;
 
     for (YAML::Node node_yaml : config_in->get_nodes()) {
-        auto new_node = make_node(node_yaml, config_in, domain_in);
-        auto found = node_map.find(new_node->name);
+        auto node_name = apply_node_template(node_yaml, config_in);
+        node::base * new_node;
+
+        if (node_yaml["class"] && ! node_yaml["chain"]) {
+            new_node = create_class_node(node_yaml, config_in, domain_in);
+            class_nodes.emplace_back(new_node, node_yaml);
+        } else {
+            new_node = make_node(node_yaml, config_in, domain_in);
+        }
 
-        if (found != node_map.end()) {
-            system_fault("duplicate node name: ", new_node->name);
+        if (node_map.find(node_name) != node_map.end()) {
+            system_fault("duplicate node name: ", node_name);
         }
 
-        node_map[new_node->name] = new_node;
+        node_map[node_name] = new_node;
+        new_nodes.push_back(new_node);
+    }
+
+    log_info("made ", new_nodes.size(), " nodes in domain ", domain_in->name, " in ", phase_time.get_ms(), " ms");
+    phase_time.restart();
+
+    std::vector<node::base *> init_list;
+
+    for (auto&& i : class_nodes) {
+        record(config_in, op_type::init_node, { i.first });
+        init_list.push_back(i.first);
+    }
+
+    node::init_nodes(init_list);
+
+    log_info("initialized ", init_list.size(), " nodes in domain ", domain_in->name, " in ", phase_time.get_ms(), " ms");
+    phase_time.restart();
+
+    for (auto&& i : class_nodes) {
+        configure_class_node(i.first, i.second, config_in, domain_in);
+    }
+
+    for (auto&& new_node : new_nodes) {
+        record(config_in, op_type::make_public, { new_node });
         domain_in->add_public_node(new_node);
     }
 
     for (auto&& node_yaml : config_in->get_nodes()) {
-        connect_nodes(node_map, node_yaml);
+        connect_nodes(node_map, node_yaml, config_in);
+    }
+
+    auto bindings = config_in->get_bindings();
+
+    if (bindings) {
+        if (! bindings.IsSequence()) {
+            system_fault("bindings section must be a list");
+        }
+
+        for (auto&& binding_yaml : bindings) {
+            make_binding(node_map, binding_yaml, config_in, domain_in);
+        }
     }
 
+    add_presets(config_in, domain_in);
+
+    log_info("configured and linked the nodes in domain ", domain_in->name, " in ", phase_time.get_ms(), " ms");
+
     return node_map;
 }
 
+static string_type yaml_string(const YAML::Node& yaml_in)
+{
+    if (! yaml_in) {
+        return "";
+    }
+
+    return YAML::Dump(yaml_in);
+}
+
+// a copy of each node definition in the domain with its template
+// applied; returns why it could not be made
+static string_type expand_nodes(std::shared_ptr<pulsar::config::domain> config_in, std::map<string_type, YAML::Node>& nodes_out)
+{
+    auto nodes = config_in->get_nodes();
+
+    if (! nodes.IsSequence()) {
+        return "the nodes section must be a list";
+    }
+
+    for (auto&& i : nodes) {
+        auto node_yaml = YAML::Clone(i);
+        auto template_node = node_yaml["template"];
+
+        if (template_node) {
+            auto template_name = template_node.as<string_type>();
+
+            if (! config_in->get_parent()->has_template(template_name)) {
+                return util::to_string("there was no node template named ", template_name);
+            }
+
+            apply_yaml_template(node_yaml, config_in->get_parent()->get_template(template_name));
+        }
+
+        if (! node_yaml["name"]) {
+            return "node configuration did not include a name";
+        }
+
+        auto node_name = node_yaml["name"].as<string_type>();
+
+        if (nodes_out.find(node_name) != nodes_out.end()) {
+            return util::to_string("duplicate node name: ", node_name);
+        }
+
+        nodes_out[node_name] = node_yaml;
+    }
+
+    return "";
+}
+
+// the parts of a node definition that would fault when the node is
+// made or changed that can be checked before it exists
+static string_type get_definition_problem(const string_type& node_name_in, const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in)
+{
+    auto class_node = node_yaml_in["class"];
+    auto chain_node = node_yaml_in["chain"];
+
+    if (class_node && chain_node) {
+        return util::to_string("specify class or chain name but not both; node = ", node_name_in);
+    } else if (! class_node && ! chain_node) {
+        return util::to_string("node did not have a class or chain name set; node = ", node_name_in);
+    } else if (class_node && ! pulsar::library::has_node_factory(class_node.as<string_type>())) {
+        return util::to_string("could not find a node factory for class name ", class_node.as<string_type>(), "; node = ", node_name_in);
+    } else if (chain_node && ! config_in->get_parent()->has_chain(chain_node.as<string_type>())) {
+        return util::to_string("could not find a chain named ", chain_node.as<string_type>(), "; node = ", node_name_in);
+    }
+
+    for (auto&& section : { "plugin", "config", "smoothing" }) {
+        auto section_node = node_yaml_in[section];
+
+        if (section_node && ! section_node.IsMap()) {
+            return util::to_string("the ", section, " section of node ", node_name_in, " must be a map");
+        }
+    }
+
+    for (auto&& section : { "sends", "receives" }) {
+        auto section_node = node_yaml_in[section];
+
+        if (section_node && ! section_node.IsSequence()) {
+            return util::to_string("the ", section, " section of node ", node_name_in, " must be a list");
+        }
+    }
+
+    for (auto&& i : node_yaml_in["smoothing"]) {
+        auto& smoothing = i.second;
+        property::smoothing_type type;
+
+        if (! smoothing.IsScalar() && ! smoothing.IsMap()) {
+            return util::to_string("smoothing for ", i.first.as<string_type>(), " of node ", node_name_in, " must be a number or a map");
+        }
+
+        if (smoothing.IsMap() && smoothing["type"] && ! property::find_smoothing_type(smoothing["type"].as<string_type>(), type)) {
+            return util::to_string("unknown smoothing type for ", i.first.as<string_type>(), " of node ", node_name_in);
+        }
+    }
+
+    return "";
+}
+
+// every name in the section has to be a property of the node and every
+// value has to be a single value
+static string_type get_section_problem(node::base * node_in, const YAML::Node& section_in, const string_type& prefix_in)
+{
+    auto& properties = node_in->get_properties();
+
+    for (auto&& i : section_in) {
+        auto property_name = prefix_in + i.first.as<string_type>();
+
+        if (properties.find(property_name) == properties.end()) {
+            return util::to_string("node ", node_in->name, " does not have a property named ", property_name);
+        }
+
+        if (! i.second.IsScalar()) {
+            return util::to_string("the value of ", property_name, " for node ", node_in->name, " must be a single value");
+        }
+    }
+
+    return "";
+}
+
+// a class node made for a reload is checked at each step make_node()
+// would fault at; the node is added to nodes_out as soon as it exists
+// so it can be discarded if the reload is given up on
+static string_type make_reload_node(const string_type& node_name_in, const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in, std::vector<node::base *>& nodes_out)
+{
+    auto new_node = pulsar::library::make_node(node_yaml_in["class"].as<string_type>(), node_name_in, domain_in);
+    auto plugin_node = node_yaml_in["plugin"];
+
+    nodes_out.push_back(new_node);
+
+    auto problem = get_section_problem(new_node, plugin_node, "plugin:");
+
+    if (problem != "") {
+        return problem;
+    }
+
+    set_properties(new_node, plugin_node, "plugin:", config_in);
+    problem = new_node->get_init_problem();
+
+    if (problem != "") {
+        return problem;
+    }
+
+    new_node->init();
+    problem = get_section_problem(new_node, node_yaml_in["config"], "config:");
+
+    if (problem != "") {
+        return problem;
+    }
+
+    auto& properties = new_node->get_properties();
+
+    for (auto&& i : node_yaml_in["smoothing"]) {
+        auto property_name = "config:" + i.first.as<string_type>();
+
+        if (properties.find(property_name) == properties.end()) {
+            return util::to_string("node ", node_name_in, " does not have a property named ", property_name);
+        }
+    }
+
+    configure_class_node(new_node, node_yaml_in, config_in, domain_in);
+
+    return "";
+}
+
+// presets are checked against the nodes the domain will have once the
+// reload is done
+static string_type get_presets_problem(const std::map<string_type, std::map<string_type, string_type>>& presets_in, const node_map_type& node_map_in)
+{
+    for (auto&& preset : presets_in) {
+        if (preset.second.size() > PULSAR_DOMAIN_UPDATE_QUEUE_SIZE) {
+            return util::to_string("preset ", preset.first, " has more values than fit in a single cycle");
+        }
+
+        for (auto&& i : preset.second) {
+            auto separator = i.first.find(':');
+
+            if (separator == string_type::npos) {
+                return util::to_string("property name in preset ", preset.first, " did not include a node name: ", i.first);
+            }
+
+            auto found_node = node_map_in.find(i.first.substr(0, separator));
+
+            if (found_node == node_map_in.end()) {
+                return util::to_string("preset ", preset.first, " refers to unknown node: ", i.first.substr(0, separator));
+            }
+
+            auto& properties = found_node->second->get_properties();
+            auto found = properties.find(node::fully_qualify_property_name(i.first.substr(separator + 1)));
+
+            if (found == properties.end()) {
+                return util::to_string("preset ", preset.first, " refers to unknown property ", i.first);
+            }
+
+            if (found->second.value->type == property::value_type::string) {
+                return util::to_string("preset ", preset.first, " can not set string property ", i.first);
+            }
+        }
+    }
+
+    return "";
+}
+
+// the parts of a node definition that are fixed once the node is made;
+// a chain also depends on the definition of the chain
+static string_type node_structure(const YAML::Node& node_yaml_in, std::shared_ptr<pulsar::config::domain> config_in)
+{
+    string_type buf;
+
+    for (auto&& key : { "class", "chain", "plugin", "sends", "receives" }) {
+        buf += key;
+        buf += "=" + yaml_string(node_yaml_in[key]) + "\n";
+    }
+
+    if (node_yaml_in["chain"]) {
+        buf += yaml_string(config_in->get_parent()->get_chain(node_yaml_in["chain"].as<string_type>()));
+    }
+
+    return buf;
+}
+
+// everything a reload does to the domain; it is all worked out before
+// any of it is done
+struct reload_plan {
+    std::unique_ptr<audio::patch> patch = std::make_unique<audio::patch>();
+    node_map_type new_map;
+    std::vector<node::base *> added_nodes;
+    std::vector<property::update> updates;
+    std::map<string_type, std::map<string_type, string_type>> presets;
+};
+
+// returns why the new config can not be used; the nodes that were made
+// for it are in the plan either way
+static string_type plan_reload(std::shared_ptr<pulsar::config::domain> running_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in, reload_plan& plan_out)
+{
+    std::map<string_type, YAML::Node> old_yaml, new_yaml;
+    node_map_type old_map;
+    auto& new_map = plan_out.new_map;
+    auto& patch = plan_out.patch;
+    std::set<node::base *> removed_nodes;
+    std::set<node::base *> kept_nodes;
+
+    auto problem = expand_nodes(running_in, old_yaml);
+
+    if (problem != "") {
+        return problem;
+    }
+
+    problem = expand_nodes(config_in, new_yaml);
+
+    if (problem != "") {
+        return problem;
+    }
+
+    for (auto&& i : new_yaml) {
+        problem = get_definition_problem(i.first, i.second, config_in);
+
+        if (problem != "") {
+            return problem;
+        }
+    }
+
+    for (auto&& i : old_yaml) {
+        auto old_node = domain_in->find_node(i.first);
+
+        if (old_node != nullptr) {
+            old_map[i.first] = old_node;
+        }
+    }
+
+    if (yaml_string(running_in->get_bindings()) != yaml_string(config_in->get_bindings())) {
+        log_error("bindings in domain ", domain_in->name, " changed; the change needs a restart");
+    }
+
+    for (auto&& i : old_yaml) {
+        auto found = old_map.find(i.first);
+
+        if (found == old_map.end() || new_yaml.find(i.first) != new_yaml.end()) {
+            continue;
+        }
+
+        auto old_node = found->second;
+        auto removal_problem = domain_in->get_removal_problem(old_node);
+
+        if (removal_problem != "") {
+            log_error("keeping node ", i.first, ": ", removal_problem);
+            new_map[i.first] = old_node;
+            kept_nodes.insert(old_node);
+            continue;
+        }
+
+        log_info("removing node ", i.first);
+        patch->remove_node(old_node);
+        removed_nodes.insert(old_node);
+    }
+
+    for (auto&& i : new_yaml) {
+        auto& node_name = i.first;
+        auto& node_yaml = i.second;
+        auto found = old_yaml.find(node_name);
+        auto old_found = old_map.find(node_name);
+
+        if (found == old_yaml.end() || old_found == old_map.end()) {
+            if (node_yaml["chain"]) {
+                log_error("chain node ", node_name, " can not be added while the domain is running");
+                continue;
+            }
+
+            log_info("adding node ", node_name);
+            problem = make_reload_node(node_name, node_yaml, config_in, domain_in, plan_out.added_nodes);
+
+            if (problem != "") {
+                return problem;
+            }
+
+            new_map[node_name] = plan_out.added_nodes.back();
+            continue;
+        }
+
+        auto old_node = old_found->second;
+        auto& old_node_yaml = found->second;
+
+        if (node_structure(old_node_yaml, running_in) != node_structure(node_yaml, config_in)) {
+            auto removal_problem = node_yaml["chain"] ? string_type("chain nodes can not be replaced while the domain is running") : domain_in->get_removal_problem(old_node);
+
+            if (removal_problem != "") {
+                log_error("keeping node ", node_name, ": ", removal_problem);
+                new_map[node_name] = old_node;
+                continue;
+            }
+
+            log_info("replacing node ", node_name);
+            patch->remove_node(old_node);
+            removed_nodes.insert(old_node);
+
+            problem = make_reload_node(node_name, node_yaml, config_in, domain_in, plan_out.added_nodes);
+
+            if (problem != "") {
+                return problem;
+            }
+
+            new_map[node_name] = plan_out.added_nodes.back();
+            continue;
+        }
+
+        new_map[node_name] = old_node;
+
+        for (auto&& key : { "smoothing", "forward" }) {
+            if (yaml_string(old_node_yaml[key]) != yaml_string(node_yaml[key])) {
+                log_error("the ", key, " section of node ", node_name, " changed; the change needs a restart");
+            }
+        }
+
+        auto old_config = old_node_yaml["config"];
+        problem = get_section_problem(old_node, node_yaml["config"], "config:");
+
+        if (problem != "") {
+            return problem;
+        }
+
+        for (auto&& value : node_yaml["config"]) {
+            auto config_name = value.first.as<string_type>();
+
+            if (old_config && yaml_string(old_config[config_name]) == yaml_string(value.second)) {
+                continue;
+            }
+
+            auto update = old_node->make_update("config:" + config_name, value.second.as<string_type>());
+
+            if (update.target != nullptr) {
+                plan_out.updates.push_back(update);
+            }
+        }
+    }
+
+    link_list_type old_links, new_links;
+
+    for (auto&& i : old_map) {
+        for (auto&& output : i.second->audio.get_outputs()) {
+            for (auto&& link : output->get_links()) {
+                old_links.emplace_back(link->from, link->to);
+            }
+        }
+    }
+
+    for (auto&& i : new_yaml) {
+        if (new_map.find(i.first) != new_map.end()) {
+            problem = find_links(new_map, i.second, new_links);
+
+            if (problem != "") {
+                return problem;
+            }
+        }
+    }
+
+    std::set<std::pair<audio::output *, audio::input *>> old_link_set(old_links.begin(), old_links.end());
+    std::set<std::pair<audio::output *, audio::input *>> new_link_set(new_links.begin(), new_links.end());
+
+    // links to a node that is removed go away with the node and the
+    // links of a node that could not be removed are left alone
+    for (auto&& i : old_link_set) {
+        auto from_node = i.first->get_parent();
+        auto to_node = i.second->get_parent();
+
+        if (new_link_set.count(i) != 0 || removed_nodes.count(from_node) != 0 || removed_nodes.count(to_node) != 0) {
+            continue;
+        }
+
+        if (kept_nodes.count(from_node) != 0 || kept_nodes.count(to_node) != 0) {
+            continue;
+        }
+
+        patch->remove_link(i.first, i.second);
+    }
+
+    for (auto&& i : new_link_set) {
+        if (old_link_set.count(i) == 0) {
+            patch->add_link(i.first, i.second);
+        }
+    }
+
+    for (auto&& node : plan_out.added_nodes) {
+        patch->add_node(node);
+    }
+
+    auto presets = config_in->get_presets();
+
+    if (presets && ! presets.IsMap()) {
+        return "presets section must be a map";
+    }
+
+    plan_out.presets = get_preset_values(config_in);
+
+    return get_presets_problem(plan_out.presets, new_map);
+}
+
+// only what changed between the two configurations is done to the
+// running domain: nodes with the same class, plugin and channels are
+// kept along with their plugin instances and get new config values,
+// and every link change lands in the same cycle. Nodes can be removed
+// and links changed over DBus after the last reload so the old nodes
+// are found in the domain by name and the old links are the ones they
+// have right now. A config that would fault is found before anything is
+// changed; the domain is then left as it was and false is returned
+bool reload_nodes(std::shared_ptr<pulsar::config::domain> running_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in, node_map_type& node_map_out)
+{
+    // keeps the old nodes from being deleted while they are used here
+    pulsar::domain::update_guard guard(*domain_in);
+    reload_plan plan;
+    string_type problem;
+
+    try {
+        problem = plan_reload(running_in, config_in, domain_in, plan);
+    } catch (const YAML::Exception& error_in) {
+        problem = error_in.what();
+    }
+
+    if (problem != "") {
+        log_error("could not reload domain ", domain_in->name, ": ", problem);
+        domain_in->discard_nodes(plan.added_nodes);
+        return false;
+    }
+
+    // the nodes that were made for the new config are retired by the
+    // domain if the patch could not be applied
+    if (! domain_in->apply_patch(std::move(plan.patch))) {
+        return false;
+    }
+
+    for (auto&& node : plan.added_nodes) {
+        domain_in->add_public_node(node);
+    }
+
+    domain_in->replace_config_presets(plan.presets);
+    domain_in->submit_updates(plan.updates);
+
+    node_map_out = plan.new_map;
+
+    return true;
+}
+
 file::file(const string_type& path_in)
 : path(path_in)
 { }
 
+// the contents are kept so anything keyed to the config uses the same
+// bytes that were parsed even if the file changes after it was read
 void file::open()
 {
-    yaml_root = YAML::LoadFile(path);
+    if (! util::read_file(path, contents)) {
+        throw YAML::Exception(YAML::Mark::null_mark(), "could not read config file " + path);
+    }
+
+    yaml_root = YAML::Load(contents);
     parse();
 }
 
+const string_type& file::get_contents()
+{
+    return contents;
+}
+
 void file::parse()
 {
     if (yaml_root["domain"] && yaml_root["domains"]) {
@@ -570,6 +1438,20 @@ YAML::Node file::get_template(const string_type& name_in)
     return template_node;
 }
 
+// the same checks get_template() faults on
+bool file::has_template(const string_type& name_in)
+{
+    auto templates_node = yaml_root["templates"];
+
+    if (! templates_node || ! templates_node.IsMap()) {
+        return false;
+    }
+
+    auto template_node = templates_node[name_in];
+
+    return template_node && template_node.IsMap();
+}
+
 const YAML::Node file::get_chains()
 {
     auto chains_node = yaml_root["chains"];
@@ -596,6 +1478,17 @@ const YAML::Node file::get_chain(const string_type& name_in)
     return chain_node;
 }
 
+bool file::has_chain(const string_type& name_in)
+{
+    auto chains_node = yaml_root["chains"];
+
+    if (! chains_node || ! chains_node.IsMap()) {
+        return false;
+    }
+
+    return bool(chains_node[name_in]);
+}
+
 const YAML::Node file::get_engine()
 {
     auto engine_node = yaml_root["engine"];
@@ -638,6 +1531,26 @@ const YAML::Node domain::get_nodes()
     return yaml_root["nodes"];
 }
 
+const YAML::Node domain::get_bindings()
+{
+    return yaml_root["bindings"];
+}
+
+const YAML::Node domain::get_presets()
+{
+    return yaml_root["presets"];
+}
+
+void domain::set_recorder(std::shared_ptr<graph> recorder_in)
+{
+    recorder = recorder_in;
+}
+
+std::shared_ptr<graph> domain::get_recorder()
+{
+    return recorder;
+}
+
 } // namespace configfile
 
 } // namespace pulsar
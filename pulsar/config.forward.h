@@ -25,10 +25,12 @@ namespace config {
 
 class domain;
 class file;
+class graph;
 
 pulsar::node::base * make_chain_node(const YAML::Node& node_yaml_in, const YAML::Node& chain_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in);
 std::shared_ptr<pulsar::domain> make_domain(std::shared_ptr<pulsar::config::domain> domain_info_in);
 std::map<string_type, pulsar::node::base *> make_nodes(std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in);
+bool reload_nodes(std::shared_ptr<pulsar::config::domain> running_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in, std::map<string_type, pulsar::node::base *>& node_map_out);
 
 
 } // namespace config
@@ -0,0 +1,354 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#include <yaml-cpp/yaml.h>
+
+#include <pulsar/config.graph.h>
+#include <pulsar/domain.h>
+#include <pulsar/library.h>
+#include <pulsar/logging.h>
+#include <pulsar/node.h>
+#include <pulsar/system.h>
+#include <pulsar/util.h>
+
+#define PULSAR_CONFIG_GRAPH_MAGIC "pulsar graph"
+
+namespace pulsar {
+
+namespace config {
+
+graph::graph(const uint64_t source_hash_in)
+: source_hash(source_hash_in)
+{ }
+
+// the version is part of the hash so a cache from an older build that
+// replays ops differently is never used
+uint64_t graph::hash_source(const string_type& contents_in)
+{
+    return util::hash(contents_in, util::hash(util::to_string(PULSAR_CONFIG_GRAPH_VERSION)));
+}
+
+// a missing, stale or damaged file is not an error; the caller builds
+// the domain from the config file instead
+std::shared_ptr<graph> graph::load(const string_type& path_in, const uint64_t source_hash_in)
+{
+    string_type contents;
+
+    if (! util::read_file(path_in, contents)) {
+        return nullptr;
+    }
+
+    util::binary_reader reader(contents);
+
+    if (reader.read_string() != PULSAR_CONFIG_GRAPH_MAGIC || reader.read_size() != PULSAR_CONFIG_GRAPH_VERSION) {
+        log_info("ignoring graph cache with the wrong format: ", path_in);
+        return nullptr;
+    }
+
+    if (reader.read_size() != source_hash_in) {
+        log_info("graph cache is out of date: ", path_in);
+        return nullptr;
+    }
+
+    auto retval = std::make_shared<graph>(source_hash_in);
+    auto num_files = reader.read_size();
+
+    for(size_type i = 0; i < num_files && ! reader.is_failed(); i++) {
+        auto file_path = reader.read_string();
+        retval->plugin_files[file_path] = reader.read_size();
+    }
+
+    auto num_ops = reader.read_size();
+
+    for(size_type i = 0; i < num_ops && ! reader.is_failed(); i++) {
+        op new_op;
+
+        new_op.type = static_cast<op_type>(reader.read_size());
+
+        auto num_numbers = reader.read_size();
+        for(size_type j = 0; j < num_numbers && ! reader.is_failed(); j++) {
+            new_op.numbers.push_back(reader.read_size());
+        }
+
+        auto num_strings = reader.read_size();
+        for(size_type j = 0; j < num_strings && ! reader.is_failed(); j++) {
+            new_op.strings.push_back(reader.read_string());
+        }
+
+        auto num_reals = reader.read_size();
+        for(size_type j = 0; j < num_reals && ! reader.is_failed(); j++) {
+            new_op.reals.push_back(reader.read_real());
+        }
+
+        retval->add_op(new_op);
+    }
+
+    if (reader.is_failed() || ! reader.at_end() || ! retval->is_valid()) {
+        log_error("ignoring damaged graph cache: ", path_in);
+        return nullptr;
+    }
+
+    for(auto&& i : retval->plugin_files) {
+        if (util::get_file_mtime(i.first) != i.second) {
+            log_info("graph cache is out of date because plugin file ", i.first, " changed: ", path_in);
+            return nullptr;
+        }
+    }
+
+    return retval;
+}
+
+bool graph::save(const string_type& path_in)
+{
+    util::binary_writer writer;
+
+    writer.write_string(PULSAR_CONFIG_GRAPH_MAGIC);
+    writer.write_size(PULSAR_CONFIG_GRAPH_VERSION);
+    writer.write_size(source_hash);
+
+    std::map<string_type, size_type> files;
+
+    for(auto&& i : node_index) {
+        for(auto&& file_path : i.first->get_plugin_files()) {
+            files[file_path] = util::get_file_mtime(file_path);
+        }
+    }
+
+    writer.write_size(files.size());
+
+    for(auto&& i : files) {
+        writer.write_string(i.first);
+        writer.write_size(i.second);
+    }
+
+    writer.write_size(ops.size());
+
+    for(auto&& i : ops) {
+        writer.write_size(static_cast<size_type>(i.type));
+
+        writer.write_size(i.numbers.size());
+        for(auto&& number : i.numbers) {
+            writer.write_size(number);
+        }
+
+        writer.write_size(i.strings.size());
+        for(auto&& string : i.strings) {
+            writer.write_string(string);
+        }
+
+        writer.write_size(i.reals.size());
+        for(auto&& real : i.reals) {
+            writer.write_real(real);
+        }
+    }
+
+    return util::write_file(path_in, writer.get_buffer());
+}
+
+size_type graph::add_node(node::base * node_in)
+{
+    auto index = node_index.size();
+    node_index[node_in] = index;
+    return index;
+}
+
+size_type graph::get_index(node::base * node_in)
+{
+    auto found = node_index.find(node_in);
+
+    if (found == node_index.end()) {
+        system_fault("node was not recorded in the graph: ", node_in->name);
+    }
+
+    return found->second;
+}
+
+void graph::add_op(const op& op_in)
+{
+    ops.push_back(op_in);
+}
+
+size_type graph::get_num_ops()
+{
+    return ops.size();
+}
+
+static bool has_arguments(const op& op_in, const size_type numbers_in, const size_type strings_in, const size_type reals_in = 0)
+{
+    return op_in.numbers.size() == numbers_in && op_in.strings.size() == strings_in && op_in.reals.size() == reals_in;
+}
+
+// every op is checked before any of them is done so a cache that does
+// not make sense is thrown away instead of stopping part way through
+// building the domain
+bool graph::is_valid()
+{
+    size_type num_nodes = 0;
+
+    auto nodes_exist = [&num_nodes](const op& op_in, const size_type count_in) {
+        for(size_type i = 0; i < count_in; i++) {
+            if (op_in.numbers[i] >= num_nodes) {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    for(auto&& i : ops) {
+        bool valid = false;
+
+        switch(i.type) {
+            case op_type::make_node:
+                valid = has_arguments(i, 0, 2);
+                num_nodes++;
+                break;
+            case op_type::set_property: valid = has_arguments(i, 2, 2) && nodes_exist(i, 1) && i.numbers[1] <= 1; break;
+            case op_type::init_node: valid = has_arguments(i, 1, 0) && nodes_exist(i, 1); break;
+            case op_type::set_smoothing:
+                valid = has_arguments(i, 3, 1) && nodes_exist(i, 1) && i.numbers[1] <= static_cast<size_type>(property::smoothing_type::exponential);
+                break;
+            case op_type::add_input: valid = has_arguments(i, 1, 1) && nodes_exist(i, 1); break;
+            case op_type::add_output: valid = has_arguments(i, 1, 1) && nodes_exist(i, 1); break;
+            case op_type::share_property: valid = has_arguments(i, 2, 1) && nodes_exist(i, 2); break;
+            case op_type::link: valid = has_arguments(i, 4, 0) && nodes_exist(i, 2); break;
+            case op_type::forward_input: valid = has_arguments(i, 2, 2) && nodes_exist(i, 2); break;
+            case op_type::forward_output: valid = has_arguments(i, 2, 2) && nodes_exist(i, 2); break;
+            case op_type::make_public: valid = has_arguments(i, 1, 0) && nodes_exist(i, 1); break;
+            case op_type::add_binding:
+                valid = has_arguments(i, 3, 2, 5) && nodes_exist(i, 2) && i.numbers[2] <= static_cast<size_type>(property::conversion::linear_to_db);
+                break;
+            case op_type::add_preset: valid = i.numbers.size() == 0 && i.reals.size() == 0 && i.strings.size() % 2 == 1; break;
+        }
+
+        if (! valid) {
+            log_debug("graph op ", static_cast<size_type>(i.type), " is not valid");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// the ops are done in the order they were recorded so the nodes see
+// the same calls they did when the config file was used; a run of
+// init_node ops is done together the same way make_nodes() does it.
+// The ops were checked when the graph was loaded
+std::map<string_type, node::base *> graph::build(std::shared_ptr<pulsar::domain> domain_in)
+{
+    std::map<string_type, node::base *> retval;
+    std::vector<node::base *> nodes;
+    std::vector<node::base *> init_list;
+
+    auto get_node = [&nodes](const size_type index_in) -> node::base * {
+        if (index_in >= nodes.size()) {
+            system_fault("graph op refers to unknown node ", index_in);
+        }
+
+        return nodes[index_in];
+    };
+
+    for(auto&& i : ops) {
+        if (i.type != op_type::init_node && ! init_list.empty()) {
+            node::init_nodes(init_list);
+            init_list.clear();
+        }
+
+        switch(i.type) {
+            case op_type::make_node: {
+                nodes.push_back(library::make_node(i.strings[0], i.strings[1], domain_in));
+                break;
+            }
+            case op_type::set_property: {
+                auto value = i.numbers[1] ? YAML::Load(i.strings[1]) : YAML::Node(i.strings[1]);
+                get_node(i.numbers[0])->get_property(i.strings[0]).value->set(value);
+                break;
+            }
+            case op_type::init_node: {
+                init_list.push_back(get_node(i.numbers[0]));
+                break;
+            }
+            case op_type::set_smoothing: {
+                property::smoothing smoothing;
+                smoothing.type = static_cast<property::smoothing_type>(i.numbers[1]);
+                smoothing.length = i.numbers[2];
+                get_node(i.numbers[0])->get_property(i.strings[0]).value->set_smoothing(smoothing);
+                break;
+            }
+            case op_type::add_input: {
+                get_node(i.numbers[0])->audio.add_input(i.strings[0]);
+                break;
+            }
+            case op_type::add_output: {
+                get_node(i.numbers[0])->audio.add_output(i.strings[0]);
+                break;
+            }
+            case op_type::share_property: {
+                auto& property = get_node(i.numbers[1])->get_property(i.strings[0]);
+                get_node(i.numbers[0])->add_property(i.strings[0], property);
+                break;
+            }
+            case op_type::link: {
+                auto output = get_node(i.numbers[0])->audio.get_output(i.numbers[2]);
+                output->link_to(get_node(i.numbers[1])->audio.get_input(i.numbers[3]));
+                break;
+            }
+            case op_type::forward_input: {
+                get_node(i.numbers[0])->audio.get_input(i.strings[0])->forward_to(get_node(i.numbers[1]), i.strings[1]);
+                break;
+            }
+            case op_type::forward_output: {
+                get_node(i.numbers[0])->audio.get_output(i.strings[0])->forward_to(get_node(i.numbers[1]), i.strings[1]);
+                break;
+            }
+            case op_type::make_public: {
+                auto node = get_node(i.numbers[0]);
+                retval[node->name] = node;
+                domain_in->add_public_node(node);
+                break;
+            }
+            case op_type::add_binding: {
+                property::binding binding;
+                binding.source = get_node(i.numbers[0])->get_property(i.strings[0]).value.get();
+                binding.target = get_node(i.numbers[1])->get_property(i.strings[1]).value.get();
+                binding.convert = static_cast<property::conversion>(i.numbers[2]);
+                binding.scale = i.reals[0];
+                binding.offset = i.reals[1];
+                binding.min = i.reals[2];
+                binding.max = i.reals[3];
+                binding.smoothing_coefficient = i.reals[4];
+                domain_in->add_binding(binding);
+                break;
+            }
+            case op_type::add_preset: {
+                std::map<string_type, string_type> values;
+
+                for(size_type j = 1; j < i.strings.size(); j += 2) {
+                    values[i.strings[j]] = i.strings[j + 1];
+                }
+
+                domain_in->add_preset(i.strings[0], values);
+                break;
+            }
+            default: system_fault("unknown graph op: ", static_cast<size_type>(i.type));
+        }
+    }
+
+    node::init_nodes(init_list);
+
+    return retval;
+}
+
+} // namespace config
+
+} // namespace pulsar
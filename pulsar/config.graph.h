@@ -0,0 +1,96 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <pulsar/domain.forward.h>
+#include <pulsar/node.forward.h>
+#include <pulsar/types.h>
+
+// bump when the layout of the file or the meaning of an op changes
+#define PULSAR_CONFIG_GRAPH_VERSION 2
+
+namespace pulsar {
+
+namespace config {
+
+enum class op_type {
+    // strings: class name, node name
+    make_node,
+    // numbers: node, 1 if the value is a YAML document instead of a
+    // scalar; strings: property name, value
+    set_property,
+    // numbers: node
+    init_node,
+    // numbers: node, smoothing type, length; strings: property name
+    set_smoothing,
+    // numbers: node; strings: channel name
+    add_input,
+    add_output,
+    // numbers: node, source node; strings: property name
+    share_property,
+    // numbers: source node, sink node, output index, input index
+    link,
+    // numbers: node, target node; strings: channel name, target channel name
+    forward_input,
+    forward_output,
+    // numbers: node
+    make_public,
+    // numbers: source node, target node, conversion; strings: source
+    // property, target property; reals: scale, offset, min, max,
+    // smoothing coefficient
+    add_binding,
+    // strings: preset name then pairs of property name and value
+    add_preset,
+};
+
+struct op {
+    op_type type;
+    std::vector<size_type> numbers;
+    std::vector<string_type> strings;
+    std::vector<double> reals;
+};
+
+// the steps taken to build the nodes of a domain from a config file
+// with templates, chains and link targets already worked out; it is
+// recorded while the config is used the slow way and then replayed on
+// later starts as long as neither the config file nor the files the
+// plugins got their ports from have changed
+class graph {
+    std::vector<op> ops;
+    std::map<node::base *, size_type> node_index;
+    // modification time of every plugin file when the graph was made
+    std::map<string_type, size_type> plugin_files;
+
+    public:
+    const uint64_t source_hash;
+    graph(const uint64_t source_hash_in);
+    static uint64_t hash_source(const string_type& contents_in);
+    static std::shared_ptr<graph> load(const string_type& path_in, const uint64_t source_hash_in);
+    bool is_valid();
+    bool save(const string_type& path_in);
+    size_type add_node(node::base * node_in);
+    size_type get_index(node::base * node_in);
+    void add_op(const op& op_in);
+    size_type get_num_ops();
+    std::map<string_type, node::base *> build(std::shared_ptr<pulsar::domain> domain_in);
+};
+
+} // namespace config
+
+} // namespace pulsar
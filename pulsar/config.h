@@ -29,6 +29,7 @@ namespace config {
 
 class file : public std::enable_shared_from_this<file> {
     private:
+    string_type contents;
     YAML::Node yaml_root;
     void open();
     void parse();
@@ -42,12 +43,15 @@ class file : public std::enable_shared_from_this<file> {
         new_file->open();
         return new_file;
     }
+    const string_type& get_contents();
     std::vector<string_type> get_domain_names();
     std::shared_ptr<domain> get_domain(const string_type& name_in = "main");
     const YAML::Node get_templates();
     YAML::Node get_template(const string_type& name_in);
+    bool has_template(const string_type& name_in);
     const YAML::Node get_chains();
     const YAML::Node get_chain(const string_type& name_in);
+    bool has_chain(const string_type& name_in);
     const YAML::Node get_engine();
     const YAML::Node get_daemons();
 };
@@ -55,6 +59,8 @@ class file : public std::enable_shared_from_this<file> {
 class domain : public std::enable_shared_from_this<domain> {
     const YAML::Node yaml_root;
     std::shared_ptr<file> parent;
+    // when set the steps taken to make the nodes are recorded in it
+    std::shared_ptr<graph> recorder;
 
     public:
     const string_type name;
@@ -67,6 +73,10 @@ class domain : public std::enable_shared_from_this<domain> {
     std::shared_ptr<file> get_parent();
     const YAML::Node get_config();
     const YAML::Node get_nodes();
+    const YAML::Node get_bindings();
+    const YAML::Node get_presets();
+    void set_recorder(std::shared_ptr<graph> recorder_in);
+    std::shared_ptr<graph> get_recorder();
 };
 
 } // namespace configfile
@@ -0,0 +1,215 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#include <pulsar/config.snapshot.h>
+#include <pulsar/logging.h>
+#include <pulsar/node.h>
+#include <pulsar/system.h>
+#include <pulsar/util.h>
+
+#define PULSAR_CONFIG_SNAPSHOT_MAGIC "pulsar snapshot"
+#define PULSAR_CONFIG_SNAPSHOT_PREFIX "config:"
+
+namespace pulsar {
+
+namespace config {
+
+// numbers are kept in their own type so a value comes back exactly the
+// way it was saved
+struct saved_value {
+    property::value_type type = property::value_type::unknown;
+    property::value_container number;
+    string_type string;
+};
+
+static void write_value(util::binary_writer& writer_in, const saved_value& value_in)
+{
+    writer_in.write_size(static_cast<size_type>(value_in.type));
+
+    switch(value_in.type) {
+        case property::value_type::size: writer_in.write_size(value_in.number.size); return;
+        case property::value_type::integer: writer_in.write_size(static_cast<size_type>(value_in.number.integer)); return;
+        case property::value_type::real: writer_in.write_real(value_in.number.real); return;
+        case property::value_type::string: writer_in.write_string(value_in.string); return;
+        default: system_fault("can not save property of unknown type");
+    }
+}
+
+// an unknown type marks the reader as failed the same way a short file does
+static saved_value read_value(util::binary_reader& reader_in, bool& failed_out)
+{
+    saved_value retval;
+
+    retval.type = static_cast<property::value_type>(reader_in.read_size());
+
+    switch(retval.type) {
+        case property::value_type::size: retval.number.size = reader_in.read_size(); break;
+        case property::value_type::integer: retval.number.integer = static_cast<integer_type>(reader_in.read_size()); break;
+        case property::value_type::real: retval.number.real = reader_in.read_real(); break;
+        case property::value_type::string: retval.string = reader_in.read_string(); break;
+        default: failed_out = true; break;
+    }
+
+    return retval;
+}
+
+// set without going through smoothing since nothing is running yet
+static void restore_value(property::storage& storage_in, const saved_value& value_in)
+{
+    switch(storage_in.type) {
+        case property::value_type::size: storage_in.set_size(value_in.number.size); return;
+        case property::value_type::integer: storage_in.set_integer(value_in.number.integer); return;
+        case property::value_type::real: storage_in.set_real(value_in.number.real); return;
+        case property::value_type::string: storage_in.set(value_in.string); return;
+        default: system_fault("can not restore property of unknown type");
+    }
+}
+
+// the values of each node come from a single cycle and can be read
+// while the domain is running
+void save_snapshot(const string_type& path_in, const uint64_t source_hash_in, const std::map<string_type, node::base *>& nodes_in)
+{
+    util::binary_writer writer;
+
+    writer.write_string(PULSAR_CONFIG_SNAPSHOT_MAGIC);
+    writer.write_size(PULSAR_CONFIG_SNAPSHOT_VERSION);
+    writer.write_size(source_hash_in);
+    writer.write_size(nodes_in.size());
+
+    for(auto&& i : nodes_in) {
+        std::map<string_type, saved_value> values;
+
+        for(auto&& number : i.second->snapshot_numbers()) {
+            if (number.first->name.find(PULSAR_CONFIG_SNAPSHOT_PREFIX) == 0) {
+                auto& value = values[number.first->name];
+                value.type = number.first->value->type;
+                value.number = number.second;
+            }
+        }
+
+        for(auto&& property : i.second->get_property_list()) {
+            if (property->value->type == property::value_type::string && property->name.find(PULSAR_CONFIG_SNAPSHOT_PREFIX) == 0) {
+                auto& value = values[property->name];
+                value.type = property::value_type::string;
+                value.string = i.second->peek(property->name);
+            }
+        }
+
+        writer.write_string(i.first);
+        writer.write_size(values.size());
+
+        for(auto&& value : values) {
+            writer.write_string(value.first);
+            write_value(writer, value.second);
+        }
+
+        writer.write_string(i.second->save_state());
+    }
+
+    if (! util::write_file(path_in, writer.get_buffer())) {
+        log_error("could not save snapshot to ", path_in);
+        return;
+    }
+
+    log_debug("saved snapshot of ", nodes_in.size(), " nodes to ", path_in);
+}
+
+// done before the domain is activated so the values are set directly
+// instead of being queued for a cycle
+bool restore_snapshot(const string_type& path_in, const uint64_t source_hash_in, const std::map<string_type, node::base *>& nodes_in)
+{
+    string_type contents;
+
+    if (! util::read_file(path_in, contents)) {
+        return false;
+    }
+
+    util::binary_reader reader(contents);
+
+    if (reader.read_string() != PULSAR_CONFIG_SNAPSHOT_MAGIC || reader.read_size() != PULSAR_CONFIG_SNAPSHOT_VERSION) {
+        log_info("ignoring snapshot with the wrong format: ", path_in);
+        return false;
+    }
+
+    if (reader.read_size() != source_hash_in) {
+        log_info("ignoring snapshot made from a different config file: ", path_in);
+        return false;
+    }
+
+    std::vector<std::pair<node::base *, std::map<string_type, saved_value>>> node_values;
+    std::vector<std::pair<node::base *, string_type>> node_states;
+    auto num_nodes = reader.read_size();
+    bool bad_value = false;
+
+    for(size_type i = 0; i < num_nodes && ! reader.is_failed() && ! bad_value; i++) {
+        auto node_name = reader.read_string();
+        auto num_values = reader.read_size();
+        std::map<string_type, saved_value> values;
+
+        for(size_type j = 0; j < num_values && ! reader.is_failed() && ! bad_value; j++) {
+            auto property_name = reader.read_string();
+            values[property_name] = read_value(reader, bad_value);
+        }
+
+        auto state = reader.read_string();
+        auto found = nodes_in.find(node_name);
+
+        if (found == nodes_in.end()) {
+            log_debug("snapshot had a node that does not exist: ", node_name);
+            continue;
+        }
+
+        node_values.emplace_back(found->second, values);
+        node_states.emplace_back(found->second, state);
+    }
+
+    // nothing is changed unless the whole file could be read
+    if (reader.is_failed() || bad_value || ! reader.at_end()) {
+        log_error("ignoring damaged snapshot: ", path_in);
+        return false;
+    }
+
+    size_type num_restored = 0;
+
+    for(auto&& i : node_values) {
+        auto& properties = i.first->get_properties();
+
+        for(auto&& value : i.second) {
+            auto found = properties.find(value.first);
+
+            if (found == properties.end()) {
+                log_debug("node ", i.first->name, " does not have snapshot property ", value.first);
+                continue;
+            }
+
+            if (found->second.value->type != value.second.type) {
+                log_debug("snapshot property ", value.first, " of node ", i.first->name, " changed type");
+                continue;
+            }
+
+            restore_value(*found->second.value, value.second);
+            num_restored++;
+        }
+    }
+
+    for(auto&& i : node_states) {
+        i.first->restore_state(i.second);
+    }
+
+    log_info("restored ", num_restored, " values from snapshot ", path_in);
+    return true;
+}
+
+} // namespace config
+
+} // namespace pulsar
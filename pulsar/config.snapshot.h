@@ -0,0 +1,38 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+#include <pulsar/node.forward.h>
+#include <pulsar/types.h>
+
+// bump when the layout of the file changes
+#define PULSAR_CONFIG_SNAPSHOT_VERSION 2
+
+namespace pulsar {
+
+namespace config {
+
+// the config: property values and plugin state of the nodes of a
+// domain; a snapshot is only restored into a domain made from the same
+// config file so a value changed in the file is never overwritten by
+// an old one
+void save_snapshot(const string_type& path_in, const uint64_t source_hash_in, const std::map<string_type, node::base *>& nodes_in);
+bool restore_snapshot(const string_type& path_in, const uint64_t source_hash_in, const std::map<string_type, node::base *>& nodes_in);
+
+} // namespace config
+
+} // namespace pulsar
@@ -11,9 +11,12 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU Lesser General Public License for more details.
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 
 #include <pulsar/dbus.h>
+#include <pulsar/debug.h>
 #include <pulsar/system.h>
 
 namespace pulsar {
@@ -22,12 +25,18 @@ namespace dbus {
 
 DBus::BusDispatcher * global_dispatcher = nullptr;
 server * global_server = nullptr;
+static std::atomic<size_type> notify_hz = ATOMIC_VAR_INIT(PULSAR_DBUS_DEFAULT_NOTIFY_HZ);
+static mutex_type notify_mutex;
+static std::list<notify_source *> notify_sources;
 
 void init()
 {
     assert(global_server == nullptr);
     assert(global_server == nullptr);
 
+    // signals are sent from the notifier thread
+    DBus::_init_threading();
+
     global_dispatcher = new DBus::BusDispatcher();
     DBus::default_dispatcher = global_dispatcher;
 
@@ -35,6 +44,41 @@ void init()
     global_server->start();
 }
 
+void set_notify_rate(const size_type hz_in)
+{
+    if (hz_in == 0) {
+        system_fault("DBus notify rate can not be 0");
+    }
+
+    notify_hz.store(hz_in);
+}
+
+void add_notify_source(notify_source * source_in)
+{
+    auto lock = debug_get_lock(notify_mutex);
+    notify_sources.push_back(source_in);
+}
+
+void remove_notify_source(notify_source * source_in)
+{
+    auto lock = debug_get_lock(notify_mutex);
+    notify_sources.remove(source_in);
+}
+
+// changes are coalesced by only looking for them at the notify rate
+static void notifier_loop()
+{
+    while(1) {
+        std::this_thread::sleep_for(std::chrono::microseconds(1000000 / notify_hz.load()));
+
+        auto lock = debug_get_lock(notify_mutex);
+
+        for(auto&& source : notify_sources) {
+            source->send_notifications();
+        }
+    }
+}
+
 DBus::Connection& get_connection()
 {
     assert(global_server != nullptr);
@@ -54,6 +98,7 @@ void server::start()
     }
 
     dispatcher_thread = new thread_type([]() -> void { global_dispatcher->enter(); });
+    notifier_thread = new thread_type(notifier_loop);
 }
 
 } // namespace dbus
@@ -14,6 +14,7 @@
 #pragma once
 
 #include <dbus-c++/dbus.h>
+#include <list>
 
 #include <pulsar/thread.h>
 #include <pulsar/types.h>
@@ -23,17 +24,30 @@
 #define PULSAR_DBUS_NAME "audio.pulsar"
 #define PULSAR_DBUS_DOMAIN_PREFIX "/Domain/"
 #define PULSAR_DBUS_NODE_PREFIX "/Node/"
+// the most times per second property change signals are sent
+#define PULSAR_DBUS_DEFAULT_NOTIFY_HZ 30
 
 namespace pulsar {
 
 namespace dbus {
 
+// polled by the notifier thread which sends out any changes that
+// happened since the last time
+struct notify_source {
+    virtual ~notify_source() = default;
+    virtual void send_notifications() = 0;
+};
+
 void init();
 DBus::Connection & get_connection();
+void set_notify_rate(const size_type hz_in);
+void add_notify_source(notify_source * source_in);
+void remove_notify_source(notify_source * source_in);
 
 struct server {
     const string_type bus_name;
     std::thread * dispatcher_thread = nullptr;
+    std::thread * notifier_thread = nullptr;
     DBus::Connection connection = DBus::Connection::SessionBus();
 
     server(const string_type& bus_name_in);
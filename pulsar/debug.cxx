@@ -12,14 +12,273 @@
 // GNU Lesser General Public License for more details.
 
 #include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <new>
+#include <pthread.h>
+#include <unistd.h>
 
 #include <pulsar/debug.h>
 
+#ifdef CONFIG_REALTIME_CHECK
+// glibc exports its allocator under these names which lets the
+// interposed functions below reach it without going through dlsym()
+// which itself allocates
+extern "C" {
+void * __libc_malloc(size_t size_in);
+void * __libc_calloc(size_t count_in, size_t size_in);
+void * __libc_realloc(void * pointer_in, size_t size_in);
+void * __libc_memalign(size_t alignment_in, size_t size_in);
+void __libc_free(void * pointer_in);
+}
+#endif
+
 namespace pulsar {
 
 namespace debug {
 
+#ifdef CONFIG_REALTIME_CHECK
+using mutex_lock_type = int (*)(pthread_mutex_t *);
+
+static std::atomic<size_type> realtime_warmup = ATOMIC_VAR_INIT(PULSAR_REALTIME_WARMUP_CYCLES);
+static std::atomic<realtime_action> allocation_action = ATOMIC_VAR_INIT(realtime_action::abort);
+static std::atomic<realtime_action> lock_action = ATOMIC_VAR_INIT(realtime_action::count);
+static std::atomic<size_type> allocation_count = ATOMIC_VAR_INIT(0);
+static std::atomic<size_type> lock_count = ATOMIC_VAR_INIT(0);
+static std::atomic<size_type> backtraces_written = ATOMIC_VAR_INIT(0);
+static mutex_lock_type real_mutex_lock = nullptr;
+// initial-exec keeps the first access on a thread from allocating
+static thread_local const char * realtime_node __attribute__((tls_model("initial-exec"))) = nullptr;
+static thread_local bool in_violation __attribute__((tls_model("initial-exec"))) = false;
+
+__attribute__((constructor)) static void init_realtime_check()
+{
+    real_mutex_lock = reinterpret_cast<mutex_lock_type>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+
+    // the first call to backtrace() loads libgcc which allocates so
+    // get it out of the way before any thread is marked
+    void * frames[1];
+    backtrace(frames, 1);
+}
+
+realtime_action realtime_action_from_name(const string_type& name_in)
+{
+    if (name_in == "ignore") {
+        return realtime_action::ignore;
+    } else if (name_in == "count") {
+        return realtime_action::count;
+    } else if (name_in == "abort") {
+        return realtime_action::abort;
+    }
+
+    system_fault("unknown realtime check action: ", name_in);
+}
+
+void set_realtime_warmup(const size_type cycles_in)
+{
+    realtime_warmup.store(cycles_in);
+}
+
+size_type get_realtime_warmup()
+{
+    return realtime_warmup.load();
+}
+
+void set_realtime_allocation_action(const realtime_action action_in)
+{
+    allocation_action.store(action_in);
+}
+
+void set_realtime_lock_action(const realtime_action action_in)
+{
+    lock_action.store(action_in);
+}
+
+realtime_report get_realtime_report()
+{
+    realtime_report retval;
+
+    retval.allocations = allocation_count.load();
+    retval.locks = lock_count.load();
+
+    return retval;
+}
+
+string_type to_string(const realtime_report& report_in)
+{
+    return util::to_string(
+        report_in.allocations, " allocations and ",
+        report_in.locks, " mutex locks made by nodes in realtime context"
+    );
+}
+
+static void write_stderr(const char * message_in)
+{
+    UNUSED auto result = write(STDERR_FILENO, message_in, strlen(message_in));
+}
+
+// the normal logging and fault paths allocate and take locks so
+// everything here goes directly to stderr
+static void realtime_violation(const realtime_action action_in, std::atomic<size_type>& counter_in, const char * what_in)
+{
+    if (action_in == realtime_action::ignore) {
+        return;
+    }
+
+    in_violation = true;
+    counter_in++;
+
+    if (action_in == realtime_action::abort || backtraces_written++ < PULSAR_REALTIME_MAX_BACKTRACES) {
+        void * frames[64];
+        auto num_frames = backtrace(frames, 64);
+
+        write_stderr("realtime check failed: ");
+        write_stderr(what_in);
+        write_stderr(" while running node ");
+        write_stderr(realtime_node);
+        write_stderr("\n");
+        backtrace_symbols_fd(frames, num_frames, STDERR_FILENO);
+    }
+
+    if (action_in == realtime_action::abort) {
+        realtime_node = nullptr;
+        abort();
+    }
+
+    in_violation = false;
+}
+
+static inline bool check_realtime()
+{
+    return realtime_node != nullptr && ! in_violation;
+}
+
+static void check_allocation(const char * what_in)
+{
+    if (check_realtime()) {
+        realtime_violation(allocation_action.load(), allocation_count, what_in);
+    }
+}
+
+static void check_lock()
+{
+    if (check_realtime()) {
+        realtime_violation(lock_action.load(), lock_count, "pthread_mutex_lock()");
+    }
+}
+
+realtime_scope::realtime_scope(const char * node_name_in, const bool armed_in)
+: previous_node(realtime_node)
+{
+    // nodes can run other nodes inline so the scopes nest
+    realtime_node = armed_in ? node_name_in : nullptr;
+}
+
+realtime_scope::~realtime_scope()
+{
+    realtime_node = previous_node;
+}
+#endif
+
 } // namespace debug
 
 } // namespace pulsar
 
+#ifdef CONFIG_REALTIME_CHECK
+extern "C" {
+
+void * malloc(size_t size_in)
+{
+    pulsar::debug::check_allocation("malloc()");
+    return __libc_malloc(size_in);
+}
+
+void * calloc(size_t count_in, size_t size_in)
+{
+    pulsar::debug::check_allocation("calloc()");
+    return __libc_calloc(count_in, size_in);
+}
+
+void * realloc(void * pointer_in, size_t size_in)
+{
+    pulsar::debug::check_allocation("realloc()");
+    return __libc_realloc(pointer_in, size_in);
+}
+
+void * memalign(size_t alignment_in, size_t size_in)
+{
+    pulsar::debug::check_allocation("memalign()");
+    return __libc_memalign(alignment_in, size_in);
+}
+
+void * aligned_alloc(size_t alignment_in, size_t size_in)
+{
+    pulsar::debug::check_allocation("aligned_alloc()");
+    return __libc_memalign(alignment_in, size_in);
+}
+
+int posix_memalign(void ** pointer_out, size_t alignment_in, size_t size_in)
+{
+    pulsar::debug::check_allocation("posix_memalign()");
+
+    auto pointer = __libc_memalign(alignment_in, size_in);
+
+    if (pointer == nullptr) {
+        return ENOMEM;
+    }
+
+    *pointer_out = pointer;
+    return 0;
+}
+
+void free(void * pointer_in)
+{
+    if (pointer_in != nullptr) {
+        pulsar::debug::check_allocation("free()");
+    }
+
+    __libc_free(pointer_in);
+}
+
+int pthread_mutex_lock(pthread_mutex_t * mutex_in)
+{
+    pulsar::debug::check_lock();
+
+    if (pulsar::debug::real_mutex_lock == nullptr) {
+        pulsar::debug::real_mutex_lock = reinterpret_cast<pulsar::debug::mutex_lock_type>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+    }
+
+    return pulsar::debug::real_mutex_lock(mutex_in);
+}
+
+} // extern "C"
+
+void * operator new(std::size_t size_in)
+{
+    pulsar::debug::check_allocation("operator new");
+
+    auto pointer = __libc_malloc(size_in == 0 ? 1 : size_in);
+
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+void operator delete(void * pointer_in) noexcept
+{
+    if (pointer_in != nullptr) {
+        pulsar::debug::check_allocation("operator delete");
+    }
+
+    __libc_free(pointer_in);
+}
+
+void operator delete(void * pointer_in, std::size_t) noexcept
+{
+    operator delete(pointer_in);
+}
+#endif
@@ -20,6 +20,12 @@
 
 #define LOCK_LOGGING
 
+// number of times a node has to run before it is expected to
+// stop allocating memory
+#define PULSAR_REALTIME_WARMUP_CYCLES 100
+// only this many violations get a backtrace written out
+#define PULSAR_REALTIME_MAX_BACKTRACES 16
+
 #define debug_get_lock(mutex) pulsar::debug::get_lock_wrapper(PULSAR_LOG_LOCK_NAME, logjam::loglevel::trace, __PRETTY_FUNCTION__, __FILE__, __LINE__, mutex, #mutex)
 #define debug_relock(lock) pulsar::debug::relock_wrapper(PULSAR_LOG_LOCK_NAME, logjam::loglevel::trace, __PRETTY_FUNCTION__, __FILE__, __LINE__, lock, #lock)
 
@@ -29,6 +35,32 @@ namespace debug {
 
 using namespace std::chrono_literals;
 
+#ifdef CONFIG_REALTIME_CHECK
+enum class realtime_action { ignore, count, abort };
+
+struct realtime_report {
+    size_type allocations = 0;
+    size_type locks = 0;
+};
+
+realtime_action realtime_action_from_name(const string_type& name_in);
+void set_realtime_warmup(const size_type cycles_in);
+size_type get_realtime_warmup();
+void set_realtime_allocation_action(const realtime_action action_in);
+void set_realtime_lock_action(const realtime_action action_in);
+realtime_report get_realtime_report();
+string_type to_string(const realtime_report& report_in);
+
+// while one of these exists on a thread the memory allocations and
+// mutex locks made by that thread are counted or abort the process
+// and are reported with a backtrace and the name of the node
+struct realtime_scope {
+    const char * previous_node;
+    realtime_scope(const char * node_name_in, const bool armed_in);
+    ~realtime_scope();
+};
+#endif
+
 template <typename T>
 std::unique_lock<T> get_lock_wrapper(const string_type& logname_in, const logjam::loglevel& level_in, const char *function_in, const char *path_in, const int& line_in, T& mutex_in, const string_type& name_in) {
     thread_local bool went_recursive = false;
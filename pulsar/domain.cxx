@@ -11,17 +11,23 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU Lesser General Public License for more details.
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <functional>
+#include <thread>
 
 #include <pulsar/async.h>
 #include <pulsar/debug.h>
 #include <pulsar/domain.h>
 #include <pulsar/logging.h>
+#include <pulsar/memory.h>
 #include <pulsar/node.h>
 
 namespace pulsar {
 
+using namespace std::chrono_literals;
+
 auto domain_list = new std::list<std::shared_ptr<domain>>();
 
 const std::list<std::shared_ptr<domain>>& get_domains()
@@ -60,6 +66,51 @@ std::string dbus_node::name()
 {
     return parent->name;
 }
+
+void dbus_node::poke_many(const std::map<std::string, std::string>& values_in)
+{
+    parent->poke_many(values_in);
+}
+
+std::map<std::string, std::string> dbus_node::snapshot()
+{
+    return parent->snapshot();
+}
+
+std::vector<std::string> dbus_node::preset_names()
+{
+    return parent->get_preset_names();
+}
+
+void dbus_node::capture_preset(const std::string& name_in, const std::vector<std::string>& properties_in)
+{
+    parent->capture_preset(name_in, properties_in);
+}
+
+void dbus_node::activate_preset(const std::string& name_in)
+{
+    parent->activate_preset(name_in);
+}
+
+void dbus_node::link(const std::string& from_in, const std::string& to_in)
+{
+    parent->link(from_in, to_in);
+}
+
+void dbus_node::unlink(const std::string& from_in, const std::string& to_in)
+{
+    parent->unlink(from_in, to_in);
+}
+
+void dbus_node::remove_node(const std::string& name_in)
+{
+    parent->remove_node(name_in);
+}
+
+void dbus_node::reload()
+{
+    parent->reload();
+}
 #endif
 
 domain::domain(const string_type& name_in, const pulsar::size_type sample_rate_in, const pulsar::size_type buffer_size_in)
@@ -68,6 +119,7 @@ domain::domain(const string_type& name_in, const pulsar::size_type sample_rate_i
     // FIXME use mprotect() to set the zero_buffer memory as read-only
     // so it can't be accidently written over
     zero_buffer->init(buffer_size_in);
+    staged_updates.reserve(PULSAR_DOMAIN_UPDATE_QUEUE_SIZE);
 }
 
 domain::~domain()
@@ -85,6 +137,8 @@ void domain::init()
 #ifdef CONFIG_ENABLE_DBUS
     dbus = new dbus_node(this->shared_from_this());
 #endif
+
+    add_topology_handler([this] { compile_presets(); });
 }
 
 void domain::shutdown()
@@ -94,15 +148,17 @@ void domain::shutdown()
 
     is_online = false;
 
+    auto lock = debug_get_lock(nodes_mutex);
+
     for(auto&& node : nodes) {
         log_trace("stopping node ", node->name);
         node->stop();
     }
 }
 
-std::shared_ptr<audio::buffer> domain::get_zero_buffer()
+audio::buffer * domain::get_zero_buffer()
 {
-    return zero_buffer;
+    return zero_buffer.get();
 }
 
 void domain::activate()
@@ -119,11 +175,759 @@ void domain::activate()
         node->activate();
     }
 
+    // all the sample buffers exist once the nodes are activated
+    // so they can be faulted in and locked before audio starts
+    memory::activate();
+    log_info("sample memory for domain ", name, ": ", memory::to_string(memory::get_report()));
+
     for(auto&& node : nodes) {
         node->start();
     }
 }
 
+// called by the node driving the domain before any node runs so the
+// new values are never seen by a plugin part way through a cycle
+void domain::begin_cycle()
+{
+    property::update update;
+
+    cycle_count++;
+
+    // a node that is not reachable from the node driving the domain
+    // can still be finishing the last cycle and the patch waits for it
+    if (pending_patch.load() != nullptr && nodes_running.load() == 0) {
+        auto patch = pending_patch.exchange(nullptr);
+
+        if (patch != nullptr) {
+            patch->apply();
+        }
+    }
+
+    while(updates.pop(update)) {
+        if (update.batch_id == 0) {
+            update.target->apply(update.value, update.offset);
+            continue;
+        }
+
+        if (staged_updates.size() > 0 && staged_updates.back().batch_id != update.batch_id) {
+            log_error("discarding an incomplete batch of property updates for domain ", name);
+            staged_updates.clear();
+        }
+
+        staged_updates.push_back(update);
+
+        if (update.batch_remaining == 0) {
+            apply_staged_updates();
+        }
+    }
+}
+
+void domain::apply_staged_updates()
+{
+    for(auto&& update : staged_updates) {
+        update.target->apply(update.value, update.offset);
+    }
+
+    staged_updates.clear();
+}
+
+// all the updates are applied at the start of the same cycle; if the
+// queue stays full the rest of the batch is dropped and the part that
+// made it in is thrown away when the next batch shows up
+void domain::submit_updates(util::span<const property::update> updates_in)
+{
+    if (updates_in.size() == 0) {
+        return;
+    }
+
+    if (updates_in.size() > PULSAR_DOMAIN_UPDATE_QUEUE_SIZE) {
+        log_error("batch of ", updates_in.size(), " property updates is too large for domain ", name);
+        return;
+    }
+
+    auto lock = debug_get_lock(submit_mutex);
+    auto batch_id = next_batch_id++;
+    auto remaining = updates_in.size();
+
+    for(auto update : updates_in) {
+        update.batch_id = batch_id;
+        update.batch_remaining = --remaining;
+
+        auto give_up = std::chrono::steady_clock::now() + PULSAR_DOMAIN_UPDATE_TIMEOUT;
+
+        while(! updates.bounded_push(update)) {
+            if (std::chrono::steady_clock::now() > give_up) {
+                log_error("property update queue is full for domain ", name, "; the updates were dropped");
+                return;
+            }
+
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+}
+
+// does not lock or wait so it is safe to call from a realtime thread
+// such as a MIDI callback; returns false if the queue was full
+bool domain::push_update(property::update update_in)
+{
+    update_in.batch_id = 0;
+    update_in.batch_remaining = 0;
+
+    return updates.bounded_push(update_in);
+}
+
+// the binding is run by whichever node publishes the source value
+// since that is the node that writes it
+void domain::add_binding(const property::binding& binding_in)
+{
+    assert(! activated);
+
+    for(auto&& node : nodes) {
+        auto& published = node->published_storage;
+
+        if (std::find(published.begin(), published.end(), binding_in.source) != published.end()) {
+            bindings.push_back(binding_in);
+            node->bindings.push_back(&bindings.back());
+            return;
+        }
+    }
+
+    system_fault("could not find the node that owns the source of a binding in domain ", name);
+}
+
+// the name is the node name and property name separated by the first :
+property::storage * domain::get_storage(const string_type& name_in)
+{
+    auto storage = find_storage(name_in);
+
+    if (storage == nullptr) {
+        system_fault("could not find property ", name_in, " in domain ", name);
+    }
+
+    return storage;
+}
+
+property::storage * domain::find_storage(const string_type& name_in)
+{
+    auto separator = name_in.find(':');
+
+    if (separator == string_type::npos) {
+        return nullptr;
+    }
+
+    auto node = find_node(name_in.substr(0, separator));
+
+    if (node == nullptr) {
+        return nullptr;
+    }
+
+    auto& properties = node->get_properties();
+    auto found = properties.find(node::fully_qualify_property_name(name_in.substr(separator + 1)));
+
+    if (found == properties.end()) {
+        return nullptr;
+    }
+
+    return found->second.value.get();
+}
+
+// presets only hold numbers since they must all land in the same cycle
+domain::preset domain::make_preset(const string_type& name_in, const std::map<string_type, string_type>& values_in)
+{
+    preset new_preset;
+
+    new_preset.from_config = true;
+
+    for(auto&& i : values_in) {
+        auto storage = get_storage(i.first);
+
+        if (storage->type == property::value_type::string) {
+            system_fault("preset ", name_in, " can not set string property ", i.first);
+        }
+
+        new_preset.values.push_back({ i.first, storage->type, storage->parse(i.second) });
+    }
+
+    if (new_preset.values.size() > PULSAR_DOMAIN_UPDATE_QUEUE_SIZE) {
+        system_fault("preset ", name_in, " has more values than fit in a single cycle");
+    }
+
+    return new_preset;
+}
+
+void domain::add_preset(const string_type& name_in, const std::map<string_type, string_type>& values_in)
+{
+    auto new_preset = make_preset(name_in, values_in);
+    auto lock = debug_get_lock(preset_mutex);
+
+    compile_preset(name_in, new_preset);
+    presets[name_in] = std::move(new_preset);
+}
+
+// a property that is gone is left out of the writes until a topology
+// change brings it back; must be called with the preset lock held
+void domain::compile_preset(const string_type& name_in, preset& preset_in)
+{
+    preset_in.writes.clear();
+
+    for(auto&& i : preset_in.values) {
+        auto storage = find_storage(i.property_name);
+
+        if (storage == nullptr || storage->type != i.type) {
+            log_error("preset ", name_in, " skips property ", i.property_name, " since it no longer exists");
+            continue;
+        }
+
+        property::update update{};
+        update.target = storage;
+        update.value = i.value;
+        preset_in.writes.push_back(update);
+    }
+}
+
+// run as a topology handler so the writes never point at a node after
+// it is deleted
+void domain::compile_presets()
+{
+    auto lock = debug_get_lock(preset_mutex);
+
+    for(auto&& i : presets) {
+        compile_preset(i.first, i.second);
+    }
+}
+
+// the presets that came from the old config are swapped for the new
+// ones all at once so there is never a time without them; presets that
+// were captured while running are kept unless the config has one with
+// the same name
+void domain::replace_config_presets(const std::map<string_type, std::map<string_type, string_type>>& presets_in)
+{
+    std::map<string_type, preset> new_presets;
+
+    for(auto&& i : presets_in) {
+        new_presets[i.first] = make_preset(i.first, i.second);
+    }
+
+    auto lock = debug_get_lock(preset_mutex);
+
+    for(auto&& i : new_presets) {
+        compile_preset(i.first, i.second);
+    }
+
+    for(auto i = presets.begin(); i != presets.end();) {
+        if (i->second.from_config) {
+            i = presets.erase(i);
+        } else {
+            i++;
+        }
+    }
+
+    for(auto&& i : new_presets) {
+        presets[i.first] = std::move(i.second);
+    }
+}
+
+// the values are the ones published at the end of the last cycle and
+// are kept as they are so nothing is lost to a round trip through text
+void domain::capture_preset(const string_type& name_in, const std::vector<string_type>& properties_in)
+{
+    preset new_preset;
+
+    update_guard guard(*this);
+
+    for(auto&& i : properties_in) {
+        auto storage = find_storage(i);
+
+        if (storage == nullptr) {
+            log_error("preset ", name_in, " was not captured: could not find property ", i, " in domain ", name);
+            return;
+        }
+
+        if (storage->type == property::value_type::string) {
+            log_error("preset ", name_in, " was not captured: can not capture string property ", i);
+            return;
+        }
+
+        new_preset.values.push_back({ i, storage->type, storage->get_published() });
+    }
+
+    if (new_preset.values.size() > PULSAR_DOMAIN_UPDATE_QUEUE_SIZE) {
+        log_error("preset ", name_in, " was not captured: it has more values than fit in a single cycle");
+        return;
+    }
+
+    auto lock = debug_get_lock(preset_mutex);
+    compile_preset(name_in, new_preset);
+    presets[name_in] = std::move(new_preset);
+}
+
+// submitting can wait for room in the queue so the writes are copied
+// out instead of holding the lock while that happens; the guard keeps
+// the nodes they point at from being deleted until they are queued
+void domain::activate_preset(const string_type& name_in)
+{
+    update_guard guard(*this);
+    auto lock = debug_get_lock(preset_mutex);
+    auto found = presets.find(name_in);
+
+    if (found == presets.end()) {
+        log_error("unknown preset ", name_in, " for domain ", name);
+        return;
+    }
+
+    auto writes = found->second.writes;
+    lock.unlock();
+
+    submit_updates(writes);
+}
+
+std::vector<string_type> domain::get_preset_names()
+{
+    auto lock = debug_get_lock(preset_mutex);
+    std::vector<string_type> retval;
+
+    for(auto&& i : presets) {
+        retval.push_back(i.first);
+    }
+
+    return retval;
+}
+
+// the new links are all put in place between the same two cycles;
+// returns false if the change was not made in which case the nodes the
+// patch would have added are retired
+bool domain::apply_patch(std::unique_ptr<audio::patch> patch_in)
+{
+    auto lock = debug_get_lock(patch_mutex);
+
+    last_patch.reset();
+    collect_retired();
+
+    auto problem = get_patch_problem(patch_in.get());
+
+    if (problem != "") {
+        log_error("topology change for domain ", name, " was not made: ", problem);
+
+        for(auto&& node : patch_in->get_added_nodes()) {
+            retire_node(node, false);
+        }
+
+        topology_changed();
+        return false;
+    }
+
+    if (activated) {
+        for(auto&& node : patch_in->get_added_nodes()) {
+            node->activate();
+            node->start();
+        }
+    }
+
+    patch_in->prepare();
+
+    if (! activated) {
+        patch_in->apply();
+    } else {
+        auto patch = patch_in.get();
+        auto give_up = std::chrono::steady_clock::now() + PULSAR_DOMAIN_PATCH_TIMEOUT;
+
+        pending_patch.store(patch);
+
+        while(! patch->is_applied()) {
+            if (std::chrono::steady_clock::now() > give_up && pending_patch.compare_exchange_strong(patch, nullptr)) {
+                log_error("domain ", name, " did not reach a cycle boundary; the topology change was not made");
+
+                for(auto&& node : patch_in->get_added_nodes()) {
+                    retire_node(node, true);
+                }
+
+                topology_changed();
+                return false;
+            }
+
+            patch = patch_in.get();
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+
+    for(auto&& node : patch_in->get_removed_nodes()) {
+        retire_node(node, true);
+    }
+
+    last_patch = std::move(patch_in);
+    topology_changed();
+
+    return true;
+}
+
+// the patch was made without the patch lock so a node it uses could
+// have been retired by another change since then; must be called with
+// the patch lock held
+string_type domain::get_patch_problem(audio::patch * patch_in)
+{
+    auto nodes_lock = debug_get_lock(nodes_mutex);
+    auto in_domain = [this](node::base * node_in) {
+        return std::find(nodes.begin(), nodes.end(), node_in) != nodes.end();
+    };
+
+    for(auto&& node : patch_in->get_changed_nodes()) {
+        if (! in_domain(node)) {
+            return util::to_string("node ", node->name, " is no longer in the domain");
+        }
+    }
+
+    for(auto&& node : patch_in->get_removed_nodes()) {
+        if (! in_domain(node)) {
+            return util::to_string("node ", node->name, " is no longer in the domain");
+        }
+    }
+
+    nodes_lock.unlock();
+
+    for(auto&& node : patch_in->get_removed_nodes()) {
+        auto problem = get_removal_problem(node);
+
+        if (problem != "") {
+            return problem;
+        }
+    }
+
+    return patch_in->get_stall_problem();
+}
+
+// for nodes that were made but never given to apply_patch() because
+// what they were made for was given up on
+void domain::discard_nodes(const std::vector<node::base *>& nodes_in)
+{
+    if (nodes_in.size() == 0) {
+        return;
+    }
+
+    auto lock = debug_get_lock(patch_mutex);
+
+    for(auto&& node : nodes_in) {
+        retire_node(node, false);
+    }
+
+    topology_changed();
+}
+
+// a node that is retired could have been found by name while it was
+// in the domain so anything holding on to what it found looks again
+// even when the links did not change; must be called with the patch
+// lock held
+void domain::topology_changed()
+{
+    topology_version++;
+
+    for(auto&& i : topology_handlers) {
+        i.second();
+    }
+}
+
+// the node is deleted once nothing can point at it any more; a node a
+// patch added that was never started is not stopped
+void domain::retire_node(node::base * node_in, const bool stop_in)
+{
+    log_info("retiring node ", node_in->name, " from domain ", name);
+
+    auto nodes_lock = debug_get_lock(nodes_mutex);
+    nodes.erase(std::find(nodes.begin(), nodes.end(), node_in));
+    nodes_lock.unlock();
+
+    if (stop_in) {
+        node_in->stop();
+    }
+
+#ifdef CONFIG_ENABLE_DBUS
+    // a node that replaces it can use the same DBus path right away
+    node_in->remove_dbus();
+#endif
+    retired_nodes.push_back({ node_in });
+}
+
+// the names are the node name and channel name separated by the first
+// :; returns false if the name has no node name in it
+static bool split_channel_name(const string_type& name_in, std::pair<string_type, string_type>& parts_out)
+{
+    auto separator = name_in.find(':');
+
+    if (separator == string_type::npos) {
+        return false;
+    }
+
+    parts_out = { name_in.substr(0, separator), name_in.substr(separator + 1) };
+    return true;
+}
+
+// the names come from outside the engine so a mistake in them is
+// logged and nothing is changed
+bool domain::find_link_ends(const string_type& from_in, const string_type& to_in, audio::output *& from_out, audio::input *& to_out)
+{
+    std::pair<string_type, string_type> from, to;
+
+    if (! split_channel_name(from_in, from) || ! split_channel_name(to_in, to)) {
+        log_error("channel names must include a node name: ", from_in, " -> ", to_in);
+        return false;
+    }
+
+    auto from_node = find_node(from.first);
+    auto to_node = find_node(to.first);
+
+    if (from_node == nullptr || to_node == nullptr) {
+        log_error("could not find node named ", from_node == nullptr ? from.first : to.first, " in domain ", name);
+        return false;
+    }
+
+    from_out = from_node->audio.find_output(from.second);
+    to_out = to_node->audio.find_input(to.second);
+
+    if (from_out == nullptr) {
+        log_error("could not find output ", from.second, " of node ", from.first);
+        return false;
+    }
+
+    if (to_out == nullptr) {
+        log_error("could not find input ", to.second, " of node ", to.first);
+        return false;
+    }
+
+    return true;
+}
+
+// the guard keeps the nodes that were found from being deleted before
+// apply_patch() sees if they are still in the domain
+bool domain::link(const string_type& from_in, const string_type& to_in)
+{
+    update_guard guard(*this);
+    audio::output * from;
+    audio::input * to;
+
+    if (! find_link_ends(from_in, to_in, from, to)) {
+        return false;
+    }
+
+    auto patch = std::make_unique<audio::patch>();
+
+    if (patch->has_link(from, to)) {
+        log_error(from_in, " is already linked to ", to_in, " in domain ", name);
+        return false;
+    }
+
+    patch->add_link(from, to);
+    return apply_patch(std::move(patch));
+}
+
+bool domain::unlink(const string_type& from_in, const string_type& to_in)
+{
+    update_guard guard(*this);
+    audio::output * from;
+    audio::input * to;
+
+    if (! find_link_ends(from_in, to_in, from, to)) {
+        return false;
+    }
+
+    auto patch = std::make_unique<audio::patch>();
+
+    if (! patch->has_link(from, to)) {
+        log_error(from_in, " is not linked to ", to_in, " in domain ", name);
+        return false;
+    }
+
+    patch->remove_link(from, to);
+    return apply_patch(std::move(patch));
+}
+
+bool domain::remove_node(const string_type& name_in)
+{
+    update_guard guard(*this);
+    auto node = find_node(name_in);
+
+    if (node == nullptr) {
+        log_error("could not find node named ", name_in, " in domain ", name);
+        return false;
+    }
+
+    auto problem = get_removal_problem(node);
+
+    if (problem != "") {
+        log_error(problem);
+        return false;
+    }
+
+    auto patch = std::make_unique<audio::patch>();
+
+    patch->remove_node(node);
+    return apply_patch(std::move(patch));
+}
+
+// anything that keeps a pointer into the node has to be gone before the
+// node is; MIDI maps and presets find their targets again when the
+// topology changes so they are not checked
+string_type domain::get_removal_problem(node::base * node_in)
+{
+    if (node_in->is_forwarder) {
+        return util::to_string("forwarding node ", node_in->name, " can not be removed while domain ", name, " is running");
+    }
+
+    if (dynamic_cast<node::io *>(node_in) != nullptr) {
+        return util::to_string("IO node ", node_in->name, " can not be removed from domain ", name);
+    }
+
+    auto& published = node_in->published_storage;
+    auto owned = [&published](property::storage * storage_in) {
+        return std::find(published.begin(), published.end(), storage_in) != published.end();
+    };
+
+    for(auto&& binding : bindings) {
+        if (owned(binding.source) || owned(binding.target)) {
+            return util::to_string("node ", node_in->name, " can not be removed because a binding uses one of its properties");
+        }
+    }
+
+    return "";
+}
+
+// an update for a retired node can only come from a producer that
+// looked it up before it was retired; once no producer is running every
+// such update is already in the queue and the first cycle that starts
+// after that takes all of them out of it, which is known to be done
+// when the cycle after it starts
+void domain::collect_retired()
+{
+    auto now = cycle_count.load();
+    auto is_quiet = update_producers.load() == 0;
+
+    retired_nodes.remove_if([now, is_quiet](retired_node& retired_in) {
+        if (! retired_in.quiet) {
+            if (is_quiet) {
+                retired_in.quiet = true;
+                retired_in.quiet_cycle = now;
+            }
+
+            return false;
+        }
+
+        if (now < retired_in.quiet_cycle + PULSAR_DOMAIN_RETIRE_CYCLES) {
+            return false;
+        }
+
+        log_debug("deleting retired node ", retired_in.node->name);
+        delete retired_in.node;
+        return true;
+    });
+}
+
+size_type domain::get_topology_version()
+{
+    return topology_version.load();
+}
+
+size_type domain::add_topology_handler(std::function<void ()> handler_in)
+{
+    auto lock = debug_get_lock(patch_mutex);
+    auto id = next_topology_handler_id++;
+
+    topology_handlers[id] = handler_in;
+
+    return id;
+}
+
+// once this returns the handler is not running and never runs again
+void domain::remove_topology_handler(const size_type id_in)
+{
+    auto lock = debug_get_lock(patch_mutex);
+    topology_handlers.erase(id_in);
+}
+
+void domain::set_reload_handler(std::function<void ()> handler_in)
+{
+    reload_handler = handler_in;
+}
+
+void domain::reload()
+{
+    if (! reload_handler) {
+        log_error("domain ", name, " was not made from a config file that can be reloaded");
+        return;
+    }
+
+    reload_handler();
+}
+
+node::base * domain::find_node(const string_type& name_in)
+{
+    auto lock = debug_get_lock(nodes_mutex);
+
+    for(auto&& node : nodes) {
+        if (node->name == name_in) {
+            return node;
+        }
+    }
+
+    return nullptr;
+}
+
+node::base * domain::get_node(const string_type& name_in)
+{
+    auto node = find_node(name_in);
+
+    if (node == nullptr) {
+        system_fault("could not find node named ", name_in, " in domain ", name);
+    }
+
+    return node;
+}
+
+// the names are the node name and property name separated by the
+// first :
+void domain::poke_many(const std::map<string_type, string_type>& values_in)
+{
+    update_guard guard(*this);
+    std::vector<property::update> batch;
+
+    for(auto&& i : values_in) {
+        auto separator = i.first.find(':');
+
+        if (separator == string_type::npos) {
+            log_error("property name did not include a node name: ", i.first);
+            continue;
+        }
+
+        auto node = find_node(i.first.substr(0, separator));
+
+        if (node == nullptr) {
+            log_error("could not find node named ", i.first.substr(0, separator), " in domain ", name);
+            continue;
+        }
+
+        auto update = node->make_update(i.first.substr(separator + 1), i.second);
+
+        if (update.target != nullptr) {
+            batch.push_back(update);
+        }
+    }
+
+    submit_updates(batch);
+}
+
+// the values of each node are from a single cycle of that node and
+// are named the same way poke_many() expects them
+std::map<string_type, string_type> domain::snapshot()
+{
+    std::map<string_type, string_type> retval;
+    auto lock = debug_get_lock(nodes_mutex);
+
+    for(auto&& node : nodes) {
+        for(auto&& i : node->snapshot()) {
+            retval[node->name + ":" + i.first] = i.second;
+        }
+    }
+
+    return retval;
+}
+
 void domain::add_ready_node(node::base * node_in)
 {
     log_trace("adding ready node: ", node_in->name);
@@ -14,8 +14,11 @@
 #pragma once
 
 #include <atomic>
+#include <boost/lockfree/queue.hpp>
 #include <condition_variable>
+#include <functional>
 #include <list>
+#include <map>
 #include <memory>
 #include <string>
 #include <thread>
@@ -24,6 +27,7 @@
 #include <pulsar/audio.h>
 #include <pulsar/domain.forward.h>
 #include <pulsar/node.forward.h>
+#include <pulsar/property.h>
 #include <pulsar/system.h>
 #include <pulsar/thread.h>
 
@@ -31,6 +35,18 @@
 #include <pulsar/dbus.h>
 #endif
 
+// the most property updates that can be waiting for the next cycle
+#define PULSAR_DOMAIN_UPDATE_QUEUE_SIZE 1024
+// how long a batch of updates waits for room in the queue
+#define PULSAR_DOMAIN_UPDATE_TIMEOUT 100ms
+// samples a plugin is run for at a time while a value is being smoothed
+#define PULSAR_DOMAIN_SMOOTHING_BLOCK_SIZE 32
+// how long a topology change waits for a cycle boundary
+#define PULSAR_DOMAIN_PATCH_TIMEOUT 1s
+// cycles that must start after nothing could still be queueing an
+// update for a retired node before it is deleted
+#define PULSAR_DOMAIN_RETIRE_CYCLES 2
+
 namespace pulsar {
 
 const std::list<std::shared_ptr<domain>>& get_domains();
@@ -42,6 +58,15 @@ struct dbus_node : public ::audio::pulsar::domain_adaptor, public DBus::Introspe
 
     dbus_node(std::shared_ptr<domain> parent_in);
     virtual std::string name() override;
+    virtual void poke_many(const std::map<std::string, std::string>& values_in) override;
+    virtual std::map<std::string, std::string> snapshot() override;
+    virtual std::vector<std::string> preset_names() override;
+    virtual void capture_preset(const std::string& name_in, const std::vector<std::string>& properties_in) override;
+    virtual void activate_preset(const std::string& name_in) override;
+    virtual void link(const std::string& from_in, const std::string& to_in) override;
+    virtual void unlink(const std::string& from_in, const std::string& to_in) override;
+    virtual void remove_node(const std::string& name_in) override;
+    virtual void reload() override;
 };
 #endif
 
@@ -51,15 +76,104 @@ struct domain : public std::enable_shared_from_this<domain> {
     dbus_node * dbus = nullptr;
 #endif
     std::shared_ptr<audio::buffer> zero_buffer = audio::buffer::make();
+    // the audio threads never walk the list of nodes so the lock is
+    // only taken by control threads
+    mutex_type nodes_mutex;
     std::vector<node::base *> nodes;
     bool activated = false;
+    // fixed capacity so neither side ever allocates
+    boost::lockfree::queue<property::update, boost::lockfree::capacity<PULSAR_DOMAIN_UPDATE_QUEUE_SIZE>> updates;
+    // only one batch is pushed at a time so batches never interleave
+    mutex_type submit_mutex;
+    // batch id 0 is used by updates that were pushed by themselves
+    size_type next_batch_id = 1;
+    // updates from a batch that has not been fully received yet
+    std::vector<property::update> staged_updates;
+    void apply_staged_updates();
+    // never moved once added because the source nodes point at them
+    std::list<property::binding> bindings;
+    // the values are already parsed and keep the property names so the
+    // writes can be made again whenever the topology changes; activating
+    // a preset only copies the writes into the update queue
+    struct preset_value {
+        string_type property_name;
+        property::value_type type;
+        property::value_container value;
+    };
+    struct preset {
+        // replaced when the config is reloaded
+        bool from_config = false;
+        std::vector<preset_value> values;
+        std::vector<property::update> writes;
+    };
+    mutex_type preset_mutex;
+    std::map<string_type, preset> presets;
+    preset make_preset(const string_type& name_in, const std::map<string_type, string_type>& values_in);
+    void compile_preset(const string_type& name_in, preset& preset_in);
+    void compile_presets();
+    property::storage * get_storage(const string_type& name_in);
+    property::storage * find_storage(const string_type& name_in);
+    // only one topology change is made at a time; the patch waiting
+    // for a cycle boundary is picked up by begin_cycle() and the one
+    // before it is kept until then so its old link lists are freed
+    // on a control thread
+    mutex_type patch_mutex;
+    std::atomic<audio::patch *> pending_patch = ATOMIC_VAR_INIT(nullptr);
+    std::unique_ptr<audio::patch> last_patch;
+    // a retired node is deleted once a cycle started and finished after
+    // the last producer that could have looked it up was done
+    struct retired_node {
+        node::base * node;
+        bool quiet = false;
+        size_type quiet_cycle = 0;
+    };
+    std::list<retired_node> retired_nodes;
+    std::atomic<size_type> update_producers = ATOMIC_VAR_INIT(0);
+    // nodes that are part way through a cycle; links are only changed
+    // when this is 0
+    std::atomic<size_type> nodes_running = ATOMIC_VAR_INIT(0);
+    std::atomic<size_type> cycle_count = ATOMIC_VAR_INIT(0);
+    std::atomic<size_type> topology_version = ATOMIC_VAR_INIT(0);
+    void collect_retired();
+    void retire_node(node::base * node_in, const bool stop_in);
+    void topology_changed();
+    string_type get_patch_problem(audio::patch * patch_in);
+    bool find_link_ends(const string_type& from_in, const string_type& to_in, audio::output *& from_out, audio::input *& to_out);
+    // run with the patch lock held after a topology change was made
+    // and before anything it retired can be deleted so pointers into
+    // the old nodes can be replaced in time
+    std::map<size_type, std::function<void ()>> topology_handlers;
+    size_type next_topology_handler_id = 1;
+    // set by whatever made the domain from a config file
+    std::function<void ()> reload_handler;
     std::atomic<bool> is_online = ATOMIC_VAR_INIT(false);
     static void execute_one_node(node::base * node_in);
 
     public:
+    // held by anything that looks up a property and then queues an
+    // update for it so the node is not deleted in between; it does not
+    // lock or allocate so a realtime thread can hold one
+    class update_guard {
+        domain& parent;
+
+        public:
+        update_guard(domain& parent_in)
+        : parent(parent_in)
+        {
+            parent.update_producers++;
+        }
+        ~update_guard()
+        {
+            parent.update_producers--;
+        }
+    };
     const string_type name;
     const pulsar::size_type sample_rate;
     const pulsar::size_type buffer_size;
+    // applied to every config: real property of the nodes as they are
+    // created by the config file
+    property::smoothing default_smoothing;
+    pulsar::size_type smoothing_block_size = PULSAR_DOMAIN_SMOOTHING_BLOCK_SIZE;
     template <typename... Args>
     static std::shared_ptr<domain> make(Args&&... args)
     {
@@ -72,20 +186,51 @@ struct domain : public std::enable_shared_from_this<domain> {
     virtual ~domain();
     void init();
     void shutdown();
-    std::shared_ptr<audio::buffer> get_zero_buffer();
+    audio::buffer * get_zero_buffer();
     void activate();
     void step();
+    void begin_cycle();
+    void submit_updates(util::span<const property::update> updates_in);
+    bool push_update(property::update update_in);
+    void add_binding(const property::binding& binding_in);
+    void add_preset(const string_type& name_in, const std::map<string_type, string_type>& values_in);
+    void capture_preset(const string_type& name_in, const std::vector<string_type>& properties_in);
+    void activate_preset(const string_type& name_in);
+    void replace_config_presets(const std::map<string_type, std::map<string_type, string_type>>& presets_in);
+    std::vector<string_type> get_preset_names();
+    bool apply_patch(std::unique_ptr<audio::patch> patch_in);
+    void discard_nodes(const std::vector<node::base *>& nodes_in);
+    bool link(const string_type& from_in, const string_type& to_in);
+    bool unlink(const string_type& from_in, const string_type& to_in);
+    bool remove_node(const string_type& name_in);
+    string_type get_removal_problem(node::base * node_in);
+    size_type get_topology_version();
+    size_type add_topology_handler(std::function<void ()> handler_in);
+    void remove_topology_handler(const size_type id_in);
+    void set_reload_handler(std::function<void ()> handler_in);
+    void reload();
+    void node_cycle_started()
+    {
+        nodes_running++;
+    }
+    void node_cycle_finished()
+    {
+        nodes_running--;
+    }
+    node::base * find_node(const string_type& name_in);
+    node::base * get_node(const string_type& name_in);
+    void poke_many(const std::map<string_type, string_type>& values_in);
+    std::map<string_type, string_type> snapshot();
     void add_ready_node(node::base * node_in);
     void add_public_node(node::base * node_in);
     template<class T, typename... Args>
     T * make_node(Args&&... args)
     {
         auto new_node = new T(args..., this->shared_from_this());
+        lock_type lock(nodes_mutex);
 
-        if (activated) {
-            new_node->activate();
-        }
-
+        // a node made after the domain is active has not been
+        // initialized yet; apply_patch() activates it once it has
         nodes.push_back(new_node);
 
         return new_node;
@@ -11,6 +11,7 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU Lesser General Public License for more details.
 
+#include <algorithm>
 #include <chrono>
 
 #include <pulsar/debug.h>
@@ -43,6 +44,7 @@ void init()
 
     library::register_node_factory("pulsar::jackaudio::node", make_node);
     library::register_daemon_factory("pulsar::jackaudio::connections", make_connections);
+    library::register_daemon_factory("pulsar::jackaudio::midi", make_midi);
 }
 
 pulsar::node::base * make_node(const string_type& name_in, std::shared_ptr<domain> domain_in)
@@ -55,6 +57,11 @@ std::shared_ptr<connections> make_connections(const string_type& name_in)
     return std::make_shared<connections>(name_in);
 }
 
+std::shared_ptr<midi> make_midi(const string_type& name_in)
+{
+    return std::make_shared<midi>(name_in);
+}
+
 } // namespace jackaudio
 
 jackaudio::node::node(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in)
@@ -204,14 +211,14 @@ void jackaudio::node::handle_jack_process(jack_nframes_t nframes_in)
     std::map<string_type, sample_type *> receives, sends;
 
     async::wait_job([&] {
-        for(auto&& name : audio.get_output_names()) {
-            auto jack_buffer = get_port_buffer(name);
-            receives[name] = jack_buffer;
+        for(auto&& output : audio.get_outputs()) {
+            auto jack_buffer = get_port_buffer(output->name);
+            receives[output->name] = jack_buffer;
         }
 
-        for(auto&& name : audio.get_input_names()) {
-            auto jack_buffer = get_port_buffer(name);
-            sends[name] = jack_buffer;
+        for(auto&& input : audio.get_inputs()) {
+            auto jack_buffer = get_port_buffer(input->name);
+            sends[input->name] = jack_buffer;
         }
     });
 
@@ -372,6 +379,119 @@ void connections::check_port_connections(const string_type&)
     }
 }
 
+midi::midi(const string_type& name_in)
+: daemon::base(name_in)
+{ }
+
+midi::~midi()
+{
+    if (jack_client != nullptr) {
+        stop();
+    }
+}
+
+void midi::init(const YAML::Node& yaml_in)
+{
+    log_debug("initializing jackaudio MIDI daemon");
+
+    if (yaml_in["client_name"]) {
+        client_name = yaml_in["client_name"].as<string_type>();
+    }
+
+    if (yaml_in["domain"]) {
+        domain_name = yaml_in["domain"].as<string_type>();
+    }
+
+    control_map.init(yaml_in["map"]);
+}
+
+void midi::start()
+{
+    log_info("starting jackaudio MIDI daemon");
+
+    assert(jack_client == nullptr);
+
+    for(auto&& i : get_domains()) {
+        if (domain_name == "" || i->name == domain_name) {
+            domain = i;
+            break;
+        }
+    }
+
+    if (domain == nullptr) {
+        system_fault("jackaudio MIDI daemon ", name, " could not find domain ", domain_name);
+    }
+
+    control_map.resolve(domain);
+
+    jack_client = jack_client_open(client_name.c_str(), jack_options, 0);
+
+    if (jack_client == nullptr) {
+        system_fault("could not open connection to jack server");
+    }
+
+    midi_port = jack_port_register(jack_client, "control_in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+
+    if (midi_port == nullptr) {
+        system_fault("could not create jackaudio MIDI port");
+    }
+
+    if (jack_set_process_callback(
+        jack_client,
+        wrap_int_nframes_cb,
+        static_cast<void *>(new std::function<void(jack_nframes_t)>([this](jack_nframes_t nframes_in) -> void {
+            this->handle_jack_process(nframes_in);
+    })))) {
+        system_fault("could not set jackaudio MIDI process callback");
+    }
+
+    if (jack_activate(jack_client)) {
+        system_fault("could not activate jack client");
+    }
+}
+
+void midi::stop()
+{
+    assert(jack_client != nullptr);
+
+    if (jack_deactivate(jack_client)) {
+        system_fault("could not deactivate jackaudio client");
+    }
+
+    if (jack_client_close(jack_client)) {
+        system_fault("could not close jackaudio client");
+    }
+
+    jack_client = nullptr;
+    midi_port = nullptr;
+
+    auto dropped = control_map.get_dropped();
+
+    if (dropped > 0) {
+        log_error("jackaudio MIDI daemon ", name, " dropped ", dropped, " updates because the queue was full");
+    }
+}
+
+// runs in the JACK realtime thread so it must not log, lock or allocate;
+// the time of each event becomes the sample the value changes at
+void midi::handle_jack_process(jack_nframes_t nframes_in)
+{
+    auto buffer = jack_port_get_buffer(midi_port, nframes_in);
+    auto num_events = jack_midi_get_event_count(buffer);
+    auto last_sample = domain->buffer_size - 1;
+
+    for(jack_nframes_t i = 0; i < num_events; i++) {
+        jack_midi_event_t event;
+
+        if (jack_midi_event_get(&event, buffer, i) != 0) {
+            continue;
+        }
+
+        auto offset = std::min(static_cast<pulsar::size_type>(event.time), last_sample);
+        control_map.handle(event.buffer, event.size, offset);
+    }
+}
+
 } // namespace jackaudio
 
 } // namespace pulsar
@@ -16,6 +16,7 @@
 #include <pulsar/async.h>
 #include <pulsar/audio.h>
 #include <pulsar/library.h>
+#include <pulsar/midi.h>
 #include <pulsar/node.h>
 
 namespace pulsar {
@@ -24,6 +25,7 @@ namespace jackaudio {
 
 extern "C" {
 #include <jack/jack.h>
+#include <jack/midiport.h>
 }
 
 using client_type = jack_client_t;
@@ -75,9 +77,30 @@ class connections : public daemon::base {
     std::map<string_type, bool> get_connection_lookup(const string_type& port_name_in);
 };
 
+// MIDI control messages are turned into property updates inside the
+// JACK process callback using the time of each event in the period
+class midi : public daemon::base {
+    string_type client_name = "pulsar_midi";
+    string_type domain_name;
+    std::shared_ptr<pulsar::domain> domain;
+    client_type * jack_client = nullptr;
+    port_type * midi_port = nullptr;
+    const options_type jack_options = JackNoStartServer;
+    pulsar::midi::map control_map;
+    void handle_jack_process(jack_nframes_t nframes_in);
+
+    public:
+    midi(const string_type& name_in);
+    virtual ~midi();
+    virtual void init(const YAML::Node& yaml_in) override;
+    virtual void start() override;
+    virtual void stop() override;
+};
+
 void init();
 pulsar::node::base * make_node(const string_type& name_in, std::shared_ptr<domain> domain_in);
 std::shared_ptr<connections> make_connections(const string_type& name_in);
+std::shared_ptr<midi> make_midi(const string_type& name_in);
 
 } // namespace jackaudio
 
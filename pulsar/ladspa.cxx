@@ -15,9 +15,12 @@
 #include <cmath>
 #include <dlfcn.h>
 
+#include <pulsar/debug.h>
 #include <pulsar/ladspa.h>
+#include <pulsar/ladspa.index.h>
 #include <pulsar/logging.h>
 #include <pulsar/system.h>
+#include <pulsar/util.h>
 
 #define DESCRIPTOR_SYMBOL "ladspa_descriptor"
 
@@ -25,6 +28,8 @@ namespace pulsar {
 
 namespace ladspa {
 
+// nodes are initialized from several threads at once
+static mutex_type loaded_files_mutex;
 static std::map<string_type, std::shared_ptr<file>> loaded_files;
 
 pulsar::node::base * make_node(const string_type& name_in, std::shared_ptr<domain> domain_in)
@@ -39,6 +44,7 @@ void init()
 
 std::shared_ptr<file> open(const string_type& path_in)
 {
+    auto lock = debug_get_lock(loaded_files_mutex);
     auto result = loaded_files.find(path_in);
 
     if (result != loaded_files.end()) {
@@ -278,6 +284,8 @@ node::node(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in
     add_property("plugin:filename", property::value_type::string);
     add_property("plugin:id", property::value_type::size);
     add_property("plugin:label", property::value_type::string);
+
+    can_split_run = true;
 }
 
 void node::init()
@@ -288,12 +296,28 @@ void node::init()
     auto ladspa_file = get_property("plugin:filename").value->get_string();
     auto ladspa_id = get_property("plugin:id").value->get_size();
 
+    // without a file name the plugin is looked up by label and/or id
+    if (ladspa_file == "") {
+        auto ladspa_label = get_property("plugin:label").value->get_string();
+
+        if (ladspa_label == "" && ladspa_id == 0) {
+            system_fault("no LADSPA plugin filename, label or id was given for node ", name);
+        }
+
+        auto entry = find_plugin(ladspa_label, ladspa_id);
+        ladspa_file = entry.path;
+        ladspa_id = entry.id;
+
+        get_property("plugin:filename").value->set(ladspa_file);
+    }
+
     ladspa = make_instance(ladspa_file, ladspa_id, domain->sample_rate);
 
     get_property("plugin:label").value->set(ladspa->get_descriptor()->Label);
     get_property("plugin:id").value->set(ladspa->get_descriptor()->UniqueID);
 
     auto port_count = ladspa->get_port_count();
+    std::vector<std::pair<size_type, property::storage *>> controls;
 
     for(size_type port_num = 0; port_num < port_count; port_num++) {
         auto port_name = ladspa->get_port_name(port_num);
@@ -303,9 +327,9 @@ void node::init()
             ladspa->connect(port_num, nullptr);
 
             if (LADSPA_IS_PORT_INPUT(descriptor)) {
-                audio.add_input(port_name);
+                input_bindings.emplace_back(port_num, audio.add_input(port_name));
             } else if (LADSPA_IS_PORT_OUTPUT(descriptor)) {
-                audio.add_output(port_name);
+                output_bindings.emplace_back(port_num, audio.add_output(port_name));
             } else {
                 system_fault("LADSPA port was neither input nor output");
             }
@@ -325,13 +349,19 @@ void node::init()
 
             auto& control = add_property(property_name, property::value_type::real);
             control.value->set(default_value);
-
-            ladspa->connect(port_num, &control.value->get_real());
+            controls.emplace_back(port_num, control.value.get());
         } else {
             system_fault("LADSPA port was neither audio nor control");
         }
     }
 
+    // the values move when they are packed
+    pack_values();
+
+    for(auto&& i : controls) {
+        ladspa->connect(i.first, &i.second->get_real());
+    }
+
     pulsar::node::filter::init();
 }
 
@@ -341,34 +371,70 @@ void node::activate()
     pulsar::node::filter::activate();
 }
 
-void node::run()
+std::vector<string_type> node::get_plugin_files()
 {
-    log_trace("running LADSPA plugin for node ", name);
+    return { get_property("plugin:filename").value->get_string() };
+}
+
+// the same lookup init() does; a file that is named is only checked to
+// exist since finding the type in it means loading it
+string_type node::get_init_problem()
+{
+    auto ladspa_file = get_property("plugin:filename").value->get_string();
+
+    if (ladspa_file != "") {
+        if (util::get_file_mtime(ladspa_file) == 0) {
+            return util::to_string("LADSPA plugin file ", ladspa_file, " for node ", name, " does not exist");
+        }
 
-    for (auto&& port_name : audio.get_input_names()) {
-        auto buffer = audio.get_input(port_name)->get_buffer();
-        auto port_num = ladspa->get_port_num(port_name);
-        ladspa->connect(port_num, buffer->get_pointer());
+        return "";
     }
 
-    for (auto&& port_name : audio.get_output_names()) {
-        auto buffer = audio.get_output(port_name)->get_buffer();
-        auto port_num = ladspa->get_port_num(port_name);
-        ladspa->connect(port_num, buffer->get_pointer());
+    auto ladspa_label = get_property("plugin:label").value->get_string();
+    auto ladspa_id = get_property("plugin:id").value->get_size();
+
+    if (ladspa_label == "" && ladspa_id == 0) {
+        return util::to_string("no LADSPA plugin filename, label or id was given for node ", name);
     }
 
-    ladspa->run(domain->buffer_size);
+    auto num_matches = find_plugins(ladspa_label, ladspa_id).size();
 
-    for (auto&& port_name : audio.get_input_names()) {
-        auto port_num = ladspa->get_port_num(port_name);
-        ladspa->connect(port_num, nullptr);
+    if (num_matches == 0) {
+        return util::to_string("could not find a LADSPA plugin with label \"", ladspa_label, "\" and id ", ladspa_id, " for node ", name);
     }
 
-    for (auto&& port_name : audio.get_output_names()) {
-        auto port_num = ladspa->get_port_num(port_name);
-        ladspa->connect(port_num, nullptr);
+    if (num_matches != 1) {
+        return util::to_string("more than one LADSPA plugin has label \"", ladspa_label, "\" for node ", name);
     }
 
+    return "";
+}
+
+template <class T>
+void node::connect_binding(port_binding<T>& binding_in, const size_type offset_in)
+{
+    auto pointer = binding_in.channel->get_buffer()->get_pointer() + offset_in;
+
+    if (pointer != binding_in.connected) {
+        ladspa->connect(binding_in.port_num, pointer);
+        binding_in.connected = pointer;
+    }
+}
+
+void node::run_block(const size_type offset_in, const size_type length_in)
+{
+    log_trace("running LADSPA plugin for node ", name);
+
+    for (auto&& binding : input_bindings) {
+        connect_binding(binding, offset_in);
+    }
+
+    for (auto&& binding : output_bindings) {
+        connect_binding(binding, offset_in);
+    }
+
+    ladspa->run(length_in);
+
     log_trace("done running LADSPA plugin for node ", name);
 }
 
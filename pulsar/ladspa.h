@@ -82,15 +82,34 @@ class instance : public std::enable_shared_from_this<instance> {
     void run(const size_type num_samples_in);
 };
 
+// audio ports are resolved to their LADSPA port number once at init
+// and the plugin is only reconnected if the buffer address changes
+template <class T>
+struct port_binding {
+    size_type port_num;
+    T * channel;
+    data_type * connected = nullptr;
+
+    port_binding(const size_type port_num_in, T * channel_in)
+    : port_num(port_num_in), channel(channel_in)
+    { }
+};
+
 class node : public pulsar::node::filter {
     protected:
     std::shared_ptr<ladspa::instance> ladspa = nullptr;
+    std::vector<port_binding<audio::input>> input_bindings;
+    std::vector<port_binding<audio::output>> output_bindings;
+    template <class T>
+    void connect_binding(port_binding<T>& binding_in, const size_type offset_in);
     virtual void init() override;
-    virtual void run() override;
+    virtual void run_block(const size_type offset_in, const size_type length_in) override;
 
     public:
     node(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in);
     virtual void activate() override;
+    virtual std::vector<string_type> get_plugin_files() override;
+    virtual string_type get_init_problem() override;
 };
 
 } // namespace ladspa
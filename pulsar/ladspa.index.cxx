@@ -0,0 +1,333 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <thread>
+
+#include <pulsar/debug.h>
+#include <pulsar/ladspa.index.h>
+#include <pulsar/logging.h>
+#include <pulsar/system.h>
+#include <pulsar/thread.h>
+#include <pulsar/util.h>
+
+#define DEFAULT_LADSPA_PATH "/usr/local/lib/ladspa:/usr/lib/ladspa"
+#define DESCRIPTOR_SYMBOL "ladspa_descriptor"
+#define INDEX_MAGIC "pulsar ladspa index"
+
+namespace pulsar {
+
+namespace ladspa {
+
+// nodes are initialized from several threads at once and the first one
+// that has to look a plugin up does the scan for all of them
+static mutex_type index_mutex;
+static string_type index_path;
+static std::vector<index_entry> index_entries;
+static bool index_loaded = false;
+static bool index_scanned = false;
+
+bool index_entry::is_in_place_broken() const
+{
+    return LADSPA_IS_INPLACE_BROKEN(properties);
+}
+
+bool index_entry::is_hard_rt_capable() const
+{
+    return LADSPA_IS_HARD_RT_CAPABLE(properties);
+}
+
+void set_index_path(const string_type& path_in)
+{
+    auto lock = debug_get_lock(index_mutex);
+    index_path = path_in;
+}
+
+std::vector<string_type> get_search_path()
+{
+    auto env_path = std::getenv("LADSPA_PATH");
+    std::vector<string_type> retval;
+
+    for(auto&& i : util::split(env_path != nullptr ? env_path : DEFAULT_LADSPA_PATH, ':')) {
+        if (i != "") {
+            retval.push_back(i);
+        }
+    }
+
+    return retval;
+}
+
+static std::vector<string_type> find_files()
+{
+    std::vector<string_type> retval;
+
+    for(auto&& directory : get_search_path()) {
+        auto handle = opendir(directory.c_str());
+
+        if (handle == nullptr) {
+            log_debug("could not open LADSPA directory ", directory);
+            continue;
+        }
+
+        while(auto entry = readdir(handle)) {
+            string_type name(entry->d_name);
+
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, ".so") == 0) {
+                retval.push_back(directory + "/" + name);
+            }
+        }
+
+        closedir(handle);
+    }
+
+    std::sort(retval.begin(), retval.end());
+
+    return retval;
+}
+
+// ladspa::file faults on anything that is not a LADSPA plugin so the
+// file is checked first; a library that is in the search path by
+// mistake is not a reason to stop
+static std::vector<index_entry> scan_file(const string_type& path_in)
+{
+    std::vector<index_entry> retval;
+    auto probe = dlopen(path_in.c_str(), RTLD_NOW);
+
+    if (probe == nullptr) {
+        log_info("skipping LADSPA file that could not be loaded: ", path_in);
+        return retval;
+    }
+
+    if (dlsym(probe, DESCRIPTOR_SYMBOL) == nullptr) {
+        log_info("skipping file without LADSPA descriptors: ", path_in);
+        dlclose(probe);
+        return retval;
+    }
+
+    auto mtime = util::get_file_mtime(path_in);
+    ladspa::file plugin_file(path_in);
+
+    for(auto&& descriptor : plugin_file.get_descriptors()) {
+        index_entry entry;
+
+        entry.path = path_in;
+        entry.file_mtime = mtime;
+        entry.id = descriptor->UniqueID;
+        entry.label = descriptor->Label;
+        entry.name = descriptor->Name;
+        entry.properties = descriptor->Properties;
+
+        for(size_type i = 0; i < descriptor->PortCount; i++) {
+            entry.ports.push_back({ descriptor->PortNames[i], descriptor->PortDescriptors[i] });
+        }
+
+        retval.push_back(entry);
+    }
+
+    dlclose(probe);
+
+    return retval;
+}
+
+// the files are opened from several threads since most of the time is
+// spent waiting on the disk when the page cache is cold
+std::vector<index_entry> scan()
+{
+    util::stopwatch timer;
+    auto files = find_files();
+    std::vector<std::vector<index_entry>> results(files.size());
+    std::atomic<size_type> next_file = ATOMIC_VAR_INIT(0);
+    std::vector<thread_type> threads;
+    size_type num_threads = std::min(static_cast<size_type>(std::thread::hardware_concurrency()), files.size());
+
+    auto worker = [&files, &results, &next_file] {
+        for(auto index = next_file++; index < files.size(); index = next_file++) {
+            results[index] = scan_file(files[index]);
+        }
+    };
+
+    if (num_threads <= 1) {
+        worker();
+    } else {
+        for(size_type i = 0; i < num_threads; i++) {
+            threads.emplace_back(worker);
+        }
+
+        for(auto&& thread : threads) {
+            thread.join();
+        }
+    }
+
+    std::vector<index_entry> retval;
+
+    for(auto&& i : results) {
+        retval.insert(retval.end(), i.begin(), i.end());
+    }
+
+    log_info("found ", retval.size(), " LADSPA plugins in ", files.size(), " files in ", timer.get_ms(), " ms");
+
+    return retval;
+}
+
+// must be called with the index mutex held
+static void load_index()
+{
+    string_type contents;
+
+    if (index_path == "" || ! util::read_file(index_path, contents)) {
+        return;
+    }
+
+    util::binary_reader reader(contents);
+
+    if (reader.read_string() != INDEX_MAGIC || reader.read_size() != PULSAR_LADSPA_INDEX_VERSION) {
+        log_info("ignoring LADSPA index with the wrong format: ", index_path);
+        return;
+    }
+
+    auto num_entries = reader.read_size();
+
+    for(size_type i = 0; i < num_entries && ! reader.is_failed(); i++) {
+        index_entry entry;
+
+        entry.path = reader.read_string();
+        entry.file_mtime = reader.read_size();
+        entry.id = reader.read_size();
+        entry.label = reader.read_string();
+        entry.name = reader.read_string();
+        entry.properties = reader.read_size();
+
+        auto num_ports = reader.read_size();
+
+        for(size_type j = 0; j < num_ports && ! reader.is_failed(); j++) {
+            index_port port;
+            port.name = reader.read_string();
+            port.descriptor = reader.read_size();
+            entry.ports.push_back(port);
+        }
+
+        index_entries.push_back(entry);
+    }
+
+    if (reader.is_failed() || ! reader.at_end()) {
+        log_error("ignoring damaged LADSPA index: ", index_path);
+        index_entries.clear();
+    }
+}
+
+// must be called with the index mutex held
+static void save_index()
+{
+    util::binary_writer writer;
+
+    writer.write_string(INDEX_MAGIC);
+    writer.write_size(PULSAR_LADSPA_INDEX_VERSION);
+    writer.write_size(index_entries.size());
+
+    for(auto&& entry : index_entries) {
+        writer.write_string(entry.path);
+        writer.write_size(entry.file_mtime);
+        writer.write_size(entry.id);
+        writer.write_string(entry.label);
+        writer.write_string(entry.name);
+        writer.write_size(entry.properties);
+        writer.write_size(entry.ports.size());
+
+        for(auto&& port : entry.ports) {
+            writer.write_string(port.name);
+            writer.write_size(port.descriptor);
+        }
+    }
+
+    if (! util::write_file(index_path, writer.get_buffer())) {
+        log_error("could not write LADSPA index to ", index_path);
+    }
+}
+
+// must be called with the index mutex held
+static std::vector<const index_entry *> match_entries(const string_type& label_in, const id_type id_in)
+{
+    std::vector<const index_entry *> retval;
+
+    for(auto&& entry : index_entries) {
+        if (label_in != "" && entry.label != label_in) continue;
+        if (id_in != 0 && entry.id != id_in) continue;
+
+        retval.push_back(&entry);
+    }
+
+    return retval;
+}
+
+// a plugin that was not found or that is in a file that changed since
+// the index was made causes one scan of the search path
+std::vector<index_entry> find_plugins(const string_type& label_in, const id_type id_in)
+{
+    auto lock = debug_get_lock(index_mutex);
+
+    if (! index_loaded) {
+        load_index();
+        index_loaded = true;
+    }
+
+    auto matches = match_entries(label_in, id_in);
+    bool stale = matches.empty();
+
+    for(auto&& entry : matches) {
+        if (entry->file_mtime != util::get_file_mtime(entry->path)) {
+            stale = true;
+        }
+    }
+
+    if (stale && ! index_scanned) {
+        index_entries = scan();
+        index_scanned = true;
+
+        if (index_path != "") {
+            save_index();
+        }
+
+        matches = match_entries(label_in, id_in);
+    }
+
+    std::vector<index_entry> retval;
+
+    for(auto&& entry : matches) {
+        retval.push_back(*entry);
+    }
+
+    return retval;
+}
+
+index_entry find_plugin(const string_type& label_in, const id_type id_in)
+{
+    auto matches = find_plugins(label_in, id_in);
+
+    if (matches.empty()) {
+        system_fault("could not find a LADSPA plugin with label \"", label_in, "\" and id ", id_in);
+    }
+
+    if (matches.size() != 1) {
+        system_fault("more than one LADSPA plugin has label \"", label_in, "\"; set plugin:id or plugin:filename");
+    }
+
+    return matches[0];
+}
+
+} // namespace ladspa
+
+} // namespace pulsar
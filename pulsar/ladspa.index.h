@@ -0,0 +1,55 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#pragma once
+
+#include <vector>
+
+#include <pulsar/ladspa.h>
+#include <pulsar/types.h>
+
+// bump when the layout of the index file changes
+#define PULSAR_LADSPA_INDEX_VERSION 1
+
+namespace pulsar {
+
+namespace ladspa {
+
+struct index_port {
+    string_type name;
+    port_descriptor_type descriptor = 0;
+};
+
+// what is known about a plugin without loading the file it is in
+struct index_entry {
+    string_type path;
+    size_type file_mtime = 0;
+    id_type id = 0;
+    string_type label;
+    string_type name;
+    LADSPA_Properties properties = 0;
+    std::vector<index_port> ports;
+
+    bool is_in_place_broken() const;
+    bool is_hard_rt_capable() const;
+};
+
+void set_index_path(const string_type& path_in);
+std::vector<string_type> get_search_path();
+std::vector<index_entry> scan();
+std::vector<index_entry> find_plugins(const string_type& label_in, const id_type id_in);
+index_entry find_plugin(const string_type& label_in, const id_type id_in);
+
+} // namespace ladspa
+
+} // namespace pulsar
@@ -43,17 +43,29 @@ void register_node_factory(const string_type& name_in, node_factory_type factory
     node_to_factory[name_in] = factory_in;
 }
 
-node::base * make_node(const string_type& class_name_in, const string_type& name_in, std::shared_ptr<domain> domain_in)
+bool has_node_factory(const string_type& class_name_in)
 {
     auto lock = debug_get_lock(node_to_factory_mutex);
+    return node_to_factory.count(class_name_in) != 0;
+}
 
-    auto result = node_to_factory.find(class_name_in);
+// the lock only covers finding the factory so nodes can be made from
+// several threads at once
+node::base * make_node(const string_type& class_name_in, const string_type& name_in, std::shared_ptr<domain> domain_in)
+{
+    node_factory_type factory;
 
-    if (result == node_to_factory.end()) {
-        system_fault("could not find a node factory for class name ", class_name_in);
+    {
+        auto lock = debug_get_lock(node_to_factory_mutex);
+        auto result = node_to_factory.find(class_name_in);
+
+        if (result == node_to_factory.end()) {
+            system_fault("could not find a node factory for class name ", class_name_in);
+        }
+
+        factory = result->second;
     }
 
-    auto factory = result->second;
     return factory(name_in, domain_in);
 }
 
@@ -28,6 +28,7 @@ namespace library {
 
 using node_factory_type = std::function<node::base * (const string_type&, std::shared_ptr<domain>)>;
 void register_node_factory(const string_type& name_in, node_factory_type factory_in);
+bool has_node_factory(const string_type& class_name_in);
 node::base * make_node(const string_type& class_name_in, const string_type& name_in, std::shared_ptr<domain> domain_in);
 
 using daemon_factory_type = std::function<std::shared_ptr<daemon::base> (const string_type& name_in)>;
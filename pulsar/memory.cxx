@@ -0,0 +1,249 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#include <pulsar/debug.h>
+#include <pulsar/logging.h>
+#include <pulsar/memory.h>
+#include <pulsar/system.h>
+#include <pulsar/thread.h>
+
+namespace pulsar {
+
+namespace memory {
+
+struct chunk {
+    char * base = nullptr;
+    size_type size = 0;
+    size_type used = 0;
+    bool huge_pages = false;
+    bool transparent_huge_pages = false;
+    bool prefaulted = false;
+    bool locked = false;
+};
+
+static mutex_type memory_mutex;
+static settings current_settings;
+static bool activated = false;
+static std::vector<chunk> chunks;
+// released blocks are kept for reuse by size so the chunks
+// never have to be given back while the engine runs
+static std::map<size_type, std::vector<char *>> free_blocks;
+
+static size_type round_up(const size_type value_in, const size_type multiple_in)
+{
+    return (value_in + multiple_in - 1) / multiple_in * multiple_in;
+}
+
+static void prefault_chunk(chunk& chunk_in)
+{
+    auto page_size = static_cast<size_type>(sysconf(_SC_PAGESIZE));
+
+    // memory that is already handed out is in use so write back what
+    // is there instead of clearing it
+    for(size_type offset = 0; offset < chunk_in.size; offset += page_size) {
+        volatile char * p = chunk_in.base + offset;
+        *p = *p;
+    }
+
+    chunk_in.prefaulted = true;
+}
+
+static void lock_chunk(chunk& chunk_in)
+{
+    if (mlock(chunk_in.base, chunk_in.size)) {
+        log_error("could not lock ", chunk_in.size, " bytes of sample memory: ", strerror(errno));
+        return;
+    }
+
+    chunk_in.locked = true;
+}
+
+static void activate_chunk(chunk& chunk_in)
+{
+    if (current_settings.prefault && ! chunk_in.prefaulted) {
+        prefault_chunk(chunk_in);
+    }
+
+    if (current_settings.lock && ! chunk_in.locked) {
+        lock_chunk(chunk_in);
+    }
+}
+
+static chunk& add_chunk(const size_type min_size_in)
+{
+    chunk new_chunk;
+    // huge pages can only be mapped in whole huge pages, without them
+    // the configured chunk size only has to be a multiple of a page
+    auto multiple = current_settings.huge_pages ? PULSAR_MEMORY_HUGE_PAGE_SIZE : static_cast<size_type>(sysconf(_SC_PAGESIZE));
+    auto size = round_up(std::max(min_size_in, current_settings.chunk_size), multiple);
+    void * pointer = MAP_FAILED;
+
+    if (current_settings.huge_pages) {
+        pointer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (pointer != MAP_FAILED) {
+            new_chunk.huge_pages = true;
+        } else {
+            log_debug("could not map huge pages for sample memory: ", strerror(errno));
+        }
+    }
+
+    if (pointer == MAP_FAILED) {
+        pointer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (pointer == MAP_FAILED) {
+            system_fault("could not map ", size, " bytes for sample memory: ", strerror(errno));
+        }
+
+#ifdef MADV_HUGEPAGE
+        if (current_settings.huge_pages && madvise(pointer, size, MADV_HUGEPAGE) == 0) {
+            new_chunk.transparent_huge_pages = true;
+        }
+#endif
+    }
+
+    new_chunk.base = static_cast<char *>(pointer);
+    new_chunk.size = size;
+
+    log_debug("mapped a new chunk of sample memory with ", size, " bytes");
+
+    chunks.push_back(new_chunk);
+
+    if (activated) {
+        activate_chunk(chunks.back());
+    }
+
+    return chunks.back();
+}
+
+void configure(const settings& settings_in)
+{
+    auto lock = debug_get_lock(memory_mutex);
+
+    if (chunks.size() != 0) {
+        system_fault("memory settings must be configured before any sample memory is allocated");
+    }
+
+    if (settings_in.chunk_size == 0) {
+        system_fault("memory chunk size can not be 0");
+    }
+
+    if (settings_in.huge_pages && settings_in.chunk_size < PULSAR_MEMORY_HUGE_PAGE_SIZE) {
+        log_info("memory chunks are at least ", PULSAR_MEMORY_HUGE_PAGE_SIZE / 1024, " KiB when huge pages are enabled");
+    }
+
+    current_settings = settings_in;
+}
+
+const settings& get_settings()
+{
+    return current_settings;
+}
+
+sample_type * allocate(const size_type num_samples_in)
+{
+    auto lock = debug_get_lock(memory_mutex);
+    auto bytes = round_up(num_samples_in * sizeof(sample_type), PULSAR_MEMORY_ALIGNMENT);
+
+    assert(bytes > 0);
+
+    auto found = free_blocks.find(bytes);
+
+    if (found != free_blocks.end() && found->second.size() > 0) {
+        auto pointer = found->second.back();
+        found->second.pop_back();
+        return reinterpret_cast<sample_type *>(pointer);
+    }
+
+    chunk * target = nullptr;
+
+    if (chunks.size() > 0 && chunks.back().size - chunks.back().used >= bytes) {
+        target = &chunks.back();
+    } else {
+        target = &add_chunk(bytes);
+    }
+
+    auto pointer = target->base + target->used;
+    target->used += bytes;
+
+    assert(reinterpret_cast<uintptr_t>(pointer) % PULSAR_MEMORY_ALIGNMENT == 0);
+
+    return reinterpret_cast<sample_type *>(pointer);
+}
+
+void deallocate(sample_type * pointer_in, const size_type num_samples_in)
+{
+    auto lock = debug_get_lock(memory_mutex);
+    auto bytes = round_up(num_samples_in * sizeof(sample_type), PULSAR_MEMORY_ALIGNMENT);
+
+    assert(pointer_in != nullptr);
+
+    free_blocks[bytes].push_back(reinterpret_cast<char *>(pointer_in));
+}
+
+// prefault and lock all the sample memory that exists now; any
+// chunk added after this is handled as soon as it is mapped
+void activate()
+{
+    auto lock = debug_get_lock(memory_mutex);
+
+    activated = true;
+
+    for(auto&& chunk : chunks) {
+        activate_chunk(chunk);
+    }
+}
+
+report get_report()
+{
+    auto lock = debug_get_lock(memory_mutex);
+    report retval;
+
+    for(auto&& chunk : chunks) {
+        retval.chunks++;
+        retval.bytes_reserved += chunk.size;
+        retval.bytes_used += chunk.used;
+
+        if (chunk.huge_pages) retval.huge_page_bytes += chunk.size;
+        if (chunk.transparent_huge_pages) retval.transparent_huge_page_bytes += chunk.size;
+        if (chunk.prefaulted) retval.prefaulted_bytes += chunk.size;
+        if (chunk.locked) retval.locked_bytes += chunk.size;
+    }
+
+    return retval;
+}
+
+string_type to_string(const report& report_in)
+{
+    return util::to_string(
+        report_in.bytes_used, " of ", report_in.bytes_reserved, " bytes used in ", report_in.chunks, " chunks; ",
+        "huge pages: ", report_in.huge_page_bytes, " bytes; ",
+        "transparent huge pages: ", report_in.transparent_huge_page_bytes, " bytes; ",
+        "prefaulted: ", report_in.prefaulted_bytes, " bytes; ",
+        "locked: ", report_in.locked_bytes, " bytes"
+    );
+}
+
+} // namespace memory
+
+} // namespace pulsar
@@ -0,0 +1,58 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#pragma once
+
+#include <pulsar/types.h>
+
+// sample memory is always aligned to a cache line which is also
+// enough for aligned SIMD loads of up to 512 bits
+#define PULSAR_MEMORY_ALIGNMENT 64
+#define PULSAR_MEMORY_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+namespace pulsar {
+
+namespace memory {
+
+struct settings {
+    // try to back sample memory with 2 MB huge pages
+    bool huge_pages = true;
+    // touch every page at activation so none fault in the audio thread
+    bool prefault = true;
+    // mlock() the sample memory at activation
+    bool lock = true;
+    // bytes to reserve in each chunk of sample memory
+    size_type chunk_size = PULSAR_MEMORY_HUGE_PAGE_SIZE;
+};
+
+struct report {
+    size_type chunks = 0;
+    size_type bytes_reserved = 0;
+    size_type bytes_used = 0;
+    size_type huge_page_bytes = 0;
+    size_type transparent_huge_page_bytes = 0;
+    size_type prefaulted_bytes = 0;
+    size_type locked_bytes = 0;
+};
+
+void configure(const settings& settings_in);
+const settings& get_settings();
+sample_type * allocate(const size_type num_samples_in);
+void deallocate(sample_type * pointer_in, const size_type num_samples_in);
+void activate();
+report get_report();
+string_type to_string(const report& report_in);
+
+} // namespace memory
+
+} // namespace pulsar
@@ -0,0 +1,336 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include <pulsar/logging.h>
+#include <pulsar/midi.h>
+#include <pulsar/node.h>
+#include <pulsar/system.h>
+
+#define MIDI_STATUS_CONTROLLER 0xB0
+#define MIDI_CC_DATA_ENTRY_MSB 6
+#define MIDI_CC_DATA_ENTRY_LSB 38
+#define MIDI_CC_NRPN_LSB 98
+#define MIDI_CC_NRPN_MSB 99
+#define MIDI_CC_RPN_LSB 100
+#define MIDI_CC_RPN_MSB 101
+
+namespace pulsar {
+
+namespace midi {
+
+using namespace std::chrono_literals;
+
+curve_type curve_type_from_name(const string_type& name_in)
+{
+    if (name_in == "linear") {
+        return curve_type::linear;
+    } else if (name_in == "exponential") {
+        return curve_type::exponential;
+    } else if (name_in == "toggle") {
+        return curve_type::toggle;
+    }
+
+    system_fault("unknown MIDI curve type: ", name_in);
+}
+
+real_type mapping::scale(const size_type value_in, const size_type max_value_in) const
+{
+    real_type position = static_cast<real_type>(value_in) / max_value_in;
+
+    switch(curve) {
+        case curve_type::linear: return min + (max - min) * position;
+        case curve_type::exponential: return min * std::pow(max / min, position);
+        case curve_type::toggle: return position >= 0.5 ? max : min;
+    }
+
+    system_fault("should never get out of switch statement");
+}
+
+// each entry looks like
+//   { cc: 7, channel: 1, property: node:config:gain, min: -60, max: 0, curve: linear }
+// with nrpn: in place of cc: for a 14 bit NRPN controller; an entry of
+//   { node: synth }
+// sends every message to a node that takes MIDI itself
+void map::init(const YAML::Node& yaml_in)
+{
+    if (! yaml_in) {
+        return;
+    }
+
+    if (! yaml_in.IsSequence()) {
+        system_fault("MIDI map must be a list");
+    }
+
+    for(auto&& i : yaml_in) {
+        mapping new_mapping;
+
+        if (i["node"]) {
+            receiver_names.push_back(i["node"].as<string_type>());
+            continue;
+        }
+
+        if (i["cc"]) {
+            new_mapping.number = i["cc"].as<size_type>();
+
+            if (new_mapping.number > 127) {
+                system_fault("MIDI CC number must be between 0 and 127: ", new_mapping.number);
+            }
+        } else if (i["nrpn"]) {
+            new_mapping.nrpn = true;
+            new_mapping.number = i["nrpn"].as<size_type>();
+
+            if (new_mapping.number > 16383) {
+                system_fault("MIDI NRPN number must be between 0 and 16383: ", new_mapping.number);
+            }
+        } else {
+            system_fault("MIDI mapping must have a cc or nrpn number");
+        }
+
+        if (i["channel"]) {
+            new_mapping.channel = i["channel"].as<size_type>();
+
+            if (new_mapping.channel > PULSAR_MIDI_NUM_CHANNELS) {
+                system_fault("MIDI channel must be between 1 and 16: ", new_mapping.channel);
+            }
+        }
+
+        if (i["curve"]) new_mapping.curve = curve_type_from_name(i["curve"].as<string_type>());
+        if (i["min"]) new_mapping.min = i["min"].as<real_type>();
+        if (i["max"]) new_mapping.max = i["max"].as<real_type>();
+
+        if (new_mapping.curve == curve_type::exponential && (new_mapping.min <= 0 || new_mapping.max <= 0)) {
+            system_fault("exponential MIDI curves need min and max greater than 0");
+        }
+
+        if (! i["property"]) {
+            system_fault("MIDI mapping must have a property");
+        }
+
+        auto name = i["property"].as<string_type>();
+        auto separator = name.find(':');
+
+        if (separator == string_type::npos) {
+            system_fault("MIDI mapping property did not include a node name: ", name);
+        }
+
+        new_mapping.node_name = name.substr(0, separator);
+        new_mapping.property_name = node::fully_qualify_property_name(name.substr(separator + 1));
+
+        mappings.push_back(new_mapping);
+    }
+}
+
+map::~map()
+{
+    if (topology_handler_id != 0) {
+        domain->remove_topology_handler(topology_handler_id);
+    }
+
+    delete current_targets.load();
+}
+
+// a node that is missing when the map is first resolved is an error
+// in the config; one that goes away later only stops being controlled
+map::targets * map::find_targets(const bool must_exist_in)
+{
+    auto new_targets = new targets;
+
+    for(auto&& mapping : mappings) {
+        property::storage * target = nullptr;
+        auto node = domain->find_node(mapping.node_name);
+
+        if (node != nullptr) {
+            auto& properties = node->get_properties();
+            auto found = properties.find(mapping.property_name);
+
+            if (found != properties.end()) {
+                target = found->second.value.get();
+            }
+        }
+
+        if (target == nullptr) {
+            if (must_exist_in) {
+                system_fault("MIDI mapping target ", mapping.node_name, ":", mapping.property_name, " does not exist");
+            }
+
+            log_error("MIDI mapping target ", mapping.node_name, ":", mapping.property_name, " no longer exists");
+        } else if (target->type == property::value_type::string) {
+            if (must_exist_in) {
+                system_fault("MIDI can not control string property ", mapping.property_name, " of node ", mapping.node_name);
+            }
+
+            log_error("MIDI can not control string property ", mapping.property_name, " of node ", mapping.node_name);
+            target = nullptr;
+        }
+
+        new_targets->properties.push_back(target);
+    }
+
+    for(auto&& name : receiver_names) {
+        auto node = domain->find_node(name);
+
+        if (node == nullptr) {
+            if (must_exist_in) {
+                system_fault("MIDI can not be sent to node ", name, " because it does not exist");
+            }
+
+            log_error("MIDI can not be sent to node ", name, " because it no longer exists");
+            continue;
+        }
+
+        auto target = dynamic_cast<receiver *>(node);
+
+        if (target == nullptr) {
+            if (must_exist_in) {
+                system_fault("MIDI can not be sent to node ", name, " because it does not take MIDI messages");
+            }
+
+            log_error("MIDI can not be sent to node ", name, " because it does not take MIDI messages");
+            continue;
+        }
+
+        new_targets->receivers.push_back(target);
+    }
+
+    return new_targets;
+}
+
+// called with the patch lock of the domain held before any node that
+// was retired can be deleted
+void map::update_targets()
+{
+    auto old_targets = current_targets.exchange(find_targets(false));
+
+    while(handling.load()) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    delete old_targets;
+}
+
+void map::resolve(std::shared_ptr<pulsar::domain> domain_in)
+{
+    domain = domain_in;
+    current_targets.store(find_targets(true));
+    topology_handler_id = domain->add_topology_handler([this] { update_targets(); });
+}
+
+// the offset is the sample in the next cycle the change should happen at
+void map::handle(const uint8_t * message_in, const size_type size_in, const size_type offset_in)
+{
+    pulsar::domain::update_guard guard(*domain);
+
+    handling.store(true);
+
+    auto targets = current_targets.load();
+
+    for(auto&& target : targets->receivers) {
+        if (! target->receive(message_in, size_in, offset_in)) {
+            dropped++;
+        }
+    }
+
+    if (size_in >= 3 && (message_in[0] & 0xF0) == MIDI_STATUS_CONTROLLER) {
+        handle_controller(targets, message_in[0] & 0x0F, message_in[1] & 0x7F, message_in[2] & 0x7F, offset_in);
+    }
+
+    handling.store(false);
+}
+
+// for sources that put the NRPN messages together themselves
+void map::handle_nrpn(const size_type channel_in, const size_type number_in, const size_type value_in, const size_type offset_in)
+{
+    pulsar::domain::update_guard guard(*domain);
+
+    handling.store(true);
+    send(current_targets.load(), true, channel_in, number_in, value_in, 16383, offset_in);
+    handling.store(false);
+}
+
+// NRPN values are sent as a data entry MSB after the parameter number
+// is selected and may be followed by a data entry LSB; the value is
+// sent each time so a controller that only sends the MSB still works
+void map::handle_controller(targets * targets_in, const size_type channel_in, const size_type number_in, const size_type value_in, const size_type offset_in)
+{
+    auto& state = channels[channel_in];
+
+    switch(number_in) {
+        case MIDI_CC_NRPN_MSB:
+            state.nrpn_selected = true;
+            state.nrpn_number = (value_in << 7) | (state.nrpn_number & 0x7F);
+            break;
+        case MIDI_CC_NRPN_LSB:
+            state.nrpn_selected = true;
+            state.nrpn_number = (state.nrpn_number & ~static_cast<size_type>(0x7F)) | value_in;
+            break;
+        case MIDI_CC_RPN_MSB:
+        case MIDI_CC_RPN_LSB:
+            state.nrpn_selected = false;
+            break;
+        case MIDI_CC_DATA_ENTRY_MSB:
+            state.data_msb = value_in;
+            if (state.nrpn_selected) send(targets_in, true, channel_in, state.nrpn_number, value_in << 7, 16383, offset_in);
+            break;
+        case MIDI_CC_DATA_ENTRY_LSB:
+            if (state.nrpn_selected) send(targets_in, true, channel_in, state.nrpn_number, (state.data_msb << 7) | value_in, 16383, offset_in);
+            break;
+    }
+
+    send(targets_in, false, channel_in, number_in, value_in, 127, offset_in);
+}
+
+void map::send(targets * targets_in, const bool nrpn_in, const size_type channel_in, const size_type number_in, const size_type value_in, const size_type max_value_in, const size_type offset_in)
+{
+    for(size_type i = 0; i < mappings.size(); i++) {
+        auto& mapping = mappings[i];
+        auto target = targets_in->properties[i];
+
+        if (target == nullptr || mapping.nrpn != nrpn_in || mapping.number != number_in) {
+            continue;
+        }
+
+        if (mapping.channel != 0 && mapping.channel != channel_in + 1) {
+            continue;
+        }
+
+        auto scaled = mapping.scale(value_in, max_value_in);
+        property::update update{};
+
+        update.target = target;
+        update.offset = offset_in;
+
+        switch(target->type) {
+            case property::value_type::size: update.value.size = std::lround(std::max(scaled, real_type(0))); break;
+            case property::value_type::integer: update.value.integer = std::lround(scaled); break;
+            case property::value_type::real: update.value.real = scaled; break;
+            default: continue;
+        }
+
+        if (! domain->push_update(update)) {
+            dropped++;
+        }
+    }
+}
+
+size_type map::get_dropped()
+{
+    return dropped.load();
+}
+
+} // namespace midi
+
+} // namespace pulsar
@@ -0,0 +1,110 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+#include <pulsar/domain.h>
+#include <pulsar/property.h>
+#include <pulsar/types.h>
+
+#define PULSAR_MIDI_NUM_CHANNELS 16
+
+namespace pulsar {
+
+namespace midi {
+
+enum class curve_type {
+    linear,
+    exponential,
+    toggle,
+};
+
+curve_type curve_type_from_name(const string_type& name_in);
+
+// a node that takes MIDI messages as they are instead of through a
+// mapping; receive() is called from the thread the message arrived on
+// so it must not allocate or lock
+class receiver {
+    public:
+    virtual ~receiver() = default;
+    virtual bool receive(const uint8_t * message_in, const size_type size_in, const size_type offset_in) = 0;
+};
+
+// a controller that drives a property; the position of the controller
+// is scaled from 0 to 1 then put through the curve to get a value
+// between min and max
+struct mapping {
+    // 0 matches every channel
+    size_type channel = 0;
+    bool nrpn = false;
+    size_type number = 0;
+    curve_type curve = curve_type::linear;
+    real_type min = 0;
+    real_type max = 1;
+    string_type node_name;
+    string_type property_name;
+    real_type scale(const size_type value_in, const size_type max_value_in) const;
+};
+
+// turns MIDI messages into property updates for a domain; handle() does
+// not allocate or lock so it can be called from a realtime thread
+class map {
+    struct channel_state {
+        bool nrpn_selected = false;
+        size_type nrpn_number = 0;
+        size_type data_msb = 0;
+    };
+
+    // what the mappings point at in the same order as the mappings and
+    // the nodes that get every message; a mapping whose node went away
+    // points at nothing
+    struct targets {
+        std::vector<property::storage *> properties;
+        std::vector<receiver *> receivers;
+    };
+
+    std::shared_ptr<pulsar::domain> domain;
+    std::vector<mapping> mappings;
+    std::vector<string_type> receiver_names;
+    // replaced as a whole when the topology changes; handle() is only
+    // ever called from one thread at a time and says when it is using
+    // the targets so the old ones are not freed under it
+    std::atomic<targets *> current_targets = ATOMIC_VAR_INIT(nullptr);
+    std::atomic<bool> handling = ATOMIC_VAR_INIT(false);
+    size_type topology_handler_id = 0;
+    std::array<channel_state, PULSAR_MIDI_NUM_CHANNELS> channels;
+    std::atomic<size_type> dropped = ATOMIC_VAR_INIT(0);
+    targets * find_targets(const bool must_exist_in);
+    void update_targets();
+    void handle_controller(targets * targets_in, const size_type channel_in, const size_type number_in, const size_type value_in, const size_type offset_in);
+    void send(targets * targets_in, const bool nrpn_in, const size_type channel_in, const size_type number_in, const size_type value_in, const size_type max_value_in, const size_type offset_in);
+
+    public:
+    ~map();
+    void init(const YAML::Node& yaml_in);
+    void resolve(std::shared_ptr<pulsar::domain> domain_in);
+    void handle(const uint8_t * message_in, const size_type size_in, const size_type offset_in);
+    void handle_nrpn(const size_type channel_in, const size_type number_in, const size_type value_in, const size_type offset_in);
+    size_type get_dropped();
+};
+
+} // namespace midi
+
+} // namespace pulsar
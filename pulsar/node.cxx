@@ -11,10 +11,14 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU Lesser General Public License for more details.
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <stdexcept>
+#include <thread>
 
 #include <pulsar/async.h>
 #include <pulsar/audio.util.h>
@@ -46,7 +50,53 @@ size_type next_node_id()
     return ++current_node_id;
 }
 
+// the plugins behind most nodes are loaded and instantiated by init()
+// so the nodes are spread over one thread per core; nodes that open an
+// audio interface are done one at a time first since those libraries
+// are not made to be opened from several threads at once
+void init_nodes(const std::vector<base *>& nodes_in)
+{
+    std::vector<base *> parallel_nodes;
+
+    for(auto&& node : nodes_in) {
+        if (dynamic_cast<io *>(node) != nullptr) {
+            node->init();
+        } else {
+            parallel_nodes.push_back(node);
+        }
+    }
+
+    size_type num_threads = std::min(static_cast<size_type>(std::thread::hardware_concurrency()), parallel_nodes.size());
+
+    if (num_threads <= 1) {
+        for(auto&& node : parallel_nodes) {
+            node->init();
+        }
+
+        return;
+    }
+
+    std::atomic<size_type> next_node = ATOMIC_VAR_INIT(0);
+    std::vector<thread_type> threads;
+
+    for(size_type i = 0; i < num_threads; i++) {
+        threads.emplace_back([&parallel_nodes, &next_node] {
+            for(auto index = next_node++; index < parallel_nodes.size(); index = next_node++) {
+                parallel_nodes[index]->init();
+            }
+        });
+    }
+
+    for(auto&& thread : threads) {
+        thread.join();
+    }
+}
+
 #ifdef CONFIG_ENABLE_DBUS
+// nodes can be initialized from several threads at once and the DBus
+// connection keeps one list of the objects registered on it
+static mutex_type dbus_objects_mutex;
+
 static std::string make_dbus_path(const std::string& name_in)
 {
     return util::to_string(PULSAR_DBUS_NODE_PREFIX, name_in);
@@ -56,42 +106,113 @@ dbus_node::dbus_node(base * parent_in, const std::string& path_in)
 :
     DBus::ObjectAdaptor(dbus::get_connection(), path_in),
     parent(parent_in)
-{ }
+{
+    dbus::add_notify_source(this);
+}
 
-std::vector<string_type> dbus_node::property_names()
+dbus_node::~dbus_node()
 {
-    std::vector<string_type> retval;
+    dbus::remove_notify_source(this);
+}
+
+// subscriptions are counted so more than one client can watch
+// the same property
+void dbus_node::subscribe(const std::vector<std::string>& names_in)
+{
+    auto lock = debug_get_lock(subscription_mutex);
 
-    async::wait_job([this, &retval] {
-        for (auto&& i : parent->properties) {
-            retval.push_back(i.first);
+    for(auto&& i : names_in) {
+        auto name = fully_qualify_property_name(i);
+        auto& property = parent->get_property(name);
+
+        if (property.value->type == property::value_type::string) {
+            log_error("can not subscribe to string property ", name, " of node ", parent->name);
+            continue;
         }
-    });
 
-    return retval;
+        auto& subscription = subscriptions[name];
+        subscription.storage = property.value.get();
+        subscription.count++;
+    }
 }
 
-std::map<std::string, std::string> dbus_node::properties()
+void dbus_node::unsubscribe(const std::vector<std::string>& names_in)
 {
-    std::map<std::string, std::string> retval;
+    auto lock = debug_get_lock(subscription_mutex);
 
-    async::wait_job([this, &retval] {
-        for(auto&& i : parent->properties) {
-            retval[i.first] = i.second.value->get();
+    for(auto&& i : names_in) {
+        auto found = subscriptions.find(fully_qualify_property_name(i));
+
+        if (found == subscriptions.end()) {
+            continue;
         }
-    });
+
+        if (--found->second.count == 0) {
+            subscriptions.erase(found);
+        }
+    }
+}
+
+// only the published values are looked at so the audio threads are
+// never waited on
+void dbus_node::send_notifications()
+{
+    std::map<std::string, std::string> changed;
+
+    {
+        auto lock = debug_get_lock(subscription_mutex);
+
+        for(auto&& i : subscriptions) {
+            auto& subscription = i.second;
+            auto current = subscription.storage->get_published();
+
+            if (subscription.sent && memcmp(&current, &subscription.last_sent, sizeof(current)) == 0) {
+                continue;
+            }
+
+            subscription.sent = true;
+            subscription.last_sent = current;
+            changed[i.first] = subscription.storage->get();
+        }
+    }
+
+    if (changed.size() > 0) {
+        properties_changed(changed);
+    }
+}
+
+// the set of properties does not change once the node is made
+std::vector<string_type> dbus_node::property_names()
+{
+    std::vector<string_type> retval;
+
+    for (auto&& i : parent->properties) {
+        retval.push_back(i.first);
+    }
 
     return retval;
 }
 
+std::map<std::string, std::string> dbus_node::properties()
+{
+    return parent->snapshot();
+}
+
+// peek and poke do not wait on the node so there is no reason
+// to hand them to the job queue
 string_type dbus_node::peek(const std::string& name_in)
 {
-    return async::wait_job<string_type>([&] { return parent->peek(name_in); });
+    return parent->peek(name_in);
 }
 
 void dbus_node::poke(const std::string& name_in, const std::string& value_in)
 {
-    async::wait_job([&] { parent->poke(name_in, value_in); });
+    parent->poke(name_in, value_in);
+}
+
+void dbus_node::poke_many(const std::map<std::string, std::string>& values_in)
+{
+    parent->poke_many(values_in);
 }
 #endif
 
@@ -120,11 +241,23 @@ base::~base()
 #ifdef CONFIG_ENABLE_DBUS
 void base::add_dbus(const std::string path_in)
 {
+    auto lock = debug_get_lock(dbus_objects_mutex);
     dbus_nodes.push_back(new dbus_node(this, path_in));
 }
+
+void base::remove_dbus()
+{
+    auto lock = debug_get_lock(dbus_objects_mutex);
+
+    for(auto&& dbus : dbus_nodes) {
+        delete dbus;
+    }
+
+    dbus_nodes.clear();
+}
 #endif
 
-std::shared_ptr<domain> base::get_domain()
+const std::shared_ptr<domain>& base::get_domain()
 {
     return domain;
 }
@@ -140,6 +273,29 @@ property::property& base::get_property(const string_type& name_in)
     return result->second;
 }
 
+property::property& base::get_property(const size_type index_in)
+{
+    assert(index_in < property_list.size());
+    return *property_list[index_in];
+}
+
+// resolve a property name once so code that runs every cycle can
+// use the id instead of a map lookup
+size_type base::get_property_index(const string_type& name_in)
+{
+    return get_property(name_in).id;
+}
+
+size_type base::get_num_properties()
+{
+    return property_list.size();
+}
+
+util::span<property::property *> base::get_property_list()
+{
+    return property_list;
+}
+
 string_type fully_qualify_property_name(const string_type& name_in)
 {
     if (name_in.find(":") == string_type::npos) {
@@ -149,18 +305,129 @@ string_type fully_qualify_property_name(const string_type& name_in)
     return name_in;
 }
 
+// numeric values are read from the copy published at the end of the
+// last cycle so only strings need to wait for the node
 string_type base::peek(const string_type& name_in)
 {
-    auto lock = debug_get_lock(node_mutex);
     auto name = fully_qualify_property_name(name_in);
-    return get_property(name).value->get();
+    auto& property = get_property(name);
+
+    if (property.value->type == property::value_type::string) {
+        auto lock = debug_get_lock(string_mutex);
+        return property.value->get();
+    }
+
+    return property.value->get();
+}
+
+// every numeric value comes from the same cycle; if the node publishes
+// while they are being read the read is done again
+std::vector<std::pair<property::property *, property::value_container>> base::snapshot_numbers()
+{
+    std::vector<std::pair<property::property *, property::value_container>> values;
+
+    values.reserve(property_list.size());
+
+    while(1) {
+        auto before = snapshot_sequence.load(std::memory_order_acquire);
+
+        if (before % 2 != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        values.clear();
+
+        for(auto&& property : property_list) {
+            if (property->value->type != property::value_type::string) {
+                values.emplace_back(property, property->value->get_published());
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (snapshot_sequence.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+    }
+
+    return values;
+}
+
+std::map<string_type, string_type> base::snapshot()
+{
+    std::map<string_type, string_type> retval;
+
+    for(auto&& i : snapshot_numbers()) {
+        retval[i.first->name] = property::to_string(i.first->value->type, i.second);
+    }
+
+    auto lock = debug_get_lock(string_mutex);
+
+    for(auto&& property : property_list) {
+        if (property->value->type == property::value_type::string) {
+            retval[property->name] = property->value->get();
+        }
+    }
+
+    return retval;
 }
 
+// numeric values are queued with the domain and applied at the start of
+// the next cycle so a poke never waits on a running node
 void base::poke(const string_type& name_in, const string_type& value_in)
 {
-    auto lock = debug_get_lock(node_mutex);
+    pulsar::domain::update_guard guard(*domain);
+    auto update = make_update(name_in, value_in);
+
+    if (update.target != nullptr) {
+        domain->submit_updates({ &update, 1 });
+    }
+}
+
+// all the numeric values land in the same cycle
+void base::poke_many(const std::map<string_type, string_type>& values_in)
+{
+    pulsar::domain::update_guard guard(*domain);
+    std::vector<property::update> batch;
+
+    for(auto&& i : values_in) {
+        auto update = make_update(i.first, i.second);
+
+        if (update.target != nullptr) {
+            batch.push_back(update);
+        }
+    }
+
+    domain->submit_updates(batch);
+}
+
+// strings are never seen by a running plugin so they are set right
+// away and the update that comes back has no target; so does an
+// unknown name since it comes from outside the engine
+property::update base::make_update(const string_type& name_in, const string_type& value_in)
+{
     auto name = fully_qualify_property_name(name_in);
-    get_property(name).value->set(value_in);
+    auto found = properties.find(name);
+    property::update update{};
+
+    if (found == properties.end()) {
+        log_error("unknown property ", name, " for node ", this->name);
+        return update;
+    }
+
+    auto& property = found->second;
+
+    if (property.value->type == property::value_type::string) {
+        auto lock = debug_get_lock(string_mutex);
+        property.value->set(value_in);
+        return update;
+    }
+
+    update.target = property.value.get();
+    update.value = property.value->parse(value_in);
+
+    return update;
 }
 
 const std::map<string_type, property::property>& base::get_properties()
@@ -168,6 +435,24 @@ const std::map<string_type, property::property>& base::get_properties()
     return properties;
 }
 
+// the controls a plugin reads end up next to each other instead of
+// spread across the heap; plugins that hold on to the address of a
+// value pack them before connecting their ports
+void base::pack_values()
+{
+    if (packed_values != nullptr) {
+        return;
+    }
+
+    auto num_blocks = (published_storage.size() + PULSAR_NODE_VALUES_PER_BLOCK - 1) / PULSAR_NODE_VALUES_PER_BLOCK;
+    packed_values = std::make_shared<std::vector<value_block>>(num_blocks);
+
+    for(size_type i = 0; i < published_storage.size(); i++) {
+        auto& block = (*packed_values)[i / PULSAR_NODE_VALUES_PER_BLOCK];
+        published_storage[i]->move_value(&block.values[i % PULSAR_NODE_VALUES_PER_BLOCK], packed_values);
+    }
+}
+
 property::property& base::add_property(const string_type& name_in, const property::value_type& type_in)
 {
     if (properties.find(name_in) != properties.end()) system_fault("attempt to add duplicate property name: ", name_in);
@@ -175,9 +460,19 @@ property::property& base::add_property(const string_type& name_in, const propert
     auto result = properties.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(name_in),
-        std::forward_as_tuple(this, name_in, type_in)
+        std::forward_as_tuple(this, name_in, property_list.size(), type_in)
     );
 
+    property_list.push_back(&result.first->second);
+
+    if (type_in != property::value_type::string) {
+        if (packed_values != nullptr) {
+            system_fault("numeric property ", name_in, " was added to node ", name, " after its values were packed");
+        }
+
+        published_storage.push_back(result.first->second.value.get());
+    }
+
     return result.first->second;
 }
 
@@ -188,9 +483,10 @@ property::property& base::add_property(const string_type& name_in, const propert
     auto result = properties.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(name_in),
-        std::forward_as_tuple(this, name_in, property_in.value)
+        std::forward_as_tuple(this, name_in, property_list.size(), property_in.value)
     );
 
+    property_list.push_back(&result.first->second);
     return result.first->second;
 }
 
@@ -210,6 +506,10 @@ void base::start()
 void base::init_cycle()
 {
     log_trace("initializing cycle for node ", name);
+
+    in_cycle = true;
+    domain->node_cycle_started();
+
     audio.init_cycle();
 }
 
@@ -220,7 +520,45 @@ void base::notify()
 
 void base::reset_cycle()
 {
+    run_bindings();
+    publish_properties();
     audio.reset_cycle();
+
+    // activation resets the node without a cycle having started
+    if (in_cycle) {
+        in_cycle = false;
+        domain->node_cycle_finished();
+    }
+}
+
+// the results go into the domain update queue so they are seen by
+// every node at the start of the next cycle no matter what thread
+// the target node runs on
+void base::run_bindings()
+{
+    property::update update;
+
+    for(auto&& binding : bindings) {
+        if (binding->make_update(update) && domain->push_update(update)) {
+            binding->mark_sent();
+        }
+    }
+}
+
+// plugins write their outputs directly into the property storage so
+// the values get copied out for readers once the node is done running
+void base::publish_properties()
+{
+    auto sequence = snapshot_sequence.load(std::memory_order_relaxed);
+
+    snapshot_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for(auto&& storage : published_storage) {
+        storage->publish();
+    }
+
+    snapshot_sequence.store(sequence + 2, std::memory_order_release);
 }
 
 void base::stop()
@@ -235,6 +573,8 @@ void base::deactivate()
 
 void base::init()
 {
+    pack_values();
+
 #ifdef CONFIG_ENABLE_DBUS
     add_dbus(make_dbus_path(std::to_string(id)));
 #endif
@@ -245,6 +585,28 @@ bool base::is_ready()
     return audio.is_ready();
 }
 
+string_type base::save_state()
+{
+    return "";
+}
+
+void base::restore_state(const string_type& state_in)
+{
+    if (state_in != "") {
+        log_error("node ", name, " does not have plugin state to restore");
+    }
+}
+
+std::vector<string_type> base::get_plugin_files()
+{
+    return {};
+}
+
+string_type base::get_init_problem()
+{
+    return "";
+}
+
 filter::filter(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in)
 : base(name_in, domain_in, false)
 { }
@@ -255,12 +617,115 @@ void filter::input_ready()
     domain->add_ready_node(this);
 }
 
+void filter::activate()
+{
+    for(auto&& storage : published_storage) {
+        if (can_split_run) {
+            storage->set_timed(true);
+            timed_storage.push_back(storage);
+        }
+
+        if (storage->get_smoothing().type == property::smoothing_type::none) {
+            continue;
+        }
+
+        if (! can_split_run) {
+            log_info("smoothing is not supported by node ", name, " and will not be used");
+            storage->set_smoothing(property::smoothing());
+            continue;
+        }
+
+        smoothed_storage.push_back(storage);
+    }
+
+    base::activate();
+}
+
+// while any smoothed value is ramping the buffer is run in pieces with
+// the values moved along before each one so changes are not heard as
+// a step at the start of the buffer; the buffer is also split at the
+// samples values were scheduled to change at
+void filter::run()
+{
+    auto buffer_size = domain->buffer_size;
+    auto block_size = domain->smoothing_block_size;
+    size_type offset = 0;
+
+    while(offset < buffer_size) {
+        apply_scheduled(offset);
+
+        auto remaining = std::min(buffer_size, next_scheduled(offset)) - offset;
+        auto length = std::min(block_size, remaining);
+
+        if (step_ramps(length) == 0) {
+            length = remaining;
+        }
+
+        run_block(offset, length);
+        offset += length;
+    }
+
+    // anything scheduled past the end of the buffer
+    apply_scheduled(std::numeric_limits<size_type>::max());
+}
+
+void filter::run_block(const size_type, const size_type)
+{
+    system_fault("node ", name, " must implement run() or run_block()");
+}
+
+size_type filter::step_ramps(const size_type length_in)
+{
+    size_type num_ramping = 0;
+
+    for(auto&& storage : smoothed_storage) {
+        if (storage->is_ramping()) {
+            storage->step_ramp(length_in);
+            num_ramping++;
+        }
+    }
+
+    return num_ramping;
+}
+
+// the values at or before the offset were already applied so only
+// the first value waiting in each property has to be looked at
+size_type filter::next_scheduled(const size_type offset_in)
+{
+    auto retval = std::numeric_limits<size_type>::max();
+
+    for(auto&& storage : timed_storage) {
+        if (storage->is_scheduled() && storage->get_scheduled_offset() > offset_in) {
+            retval = std::min(retval, storage->get_scheduled_offset());
+        }
+    }
+
+    return retval;
+}
+
+void filter::apply_scheduled(const size_type offset_in)
+{
+    for(auto&& storage : timed_storage) {
+        while(storage->is_scheduled() && storage->get_scheduled_offset() <= offset_in) {
+            storage->apply_scheduled();
+        }
+    }
+}
+
 void filter::execute()
 {
     log_debug("--------> node ", name, " started executing");
     auto lock = debug_get_lock(node_mutex);
 
-    run();
+    // only the plugin is checked; passing the buffers on and resetting
+    // for the next cycle still take locks
+    {
+#ifdef CONFIG_REALTIME_CHECK
+        debug::realtime_scope realtime(name.c_str(), ++cycles_executed > debug::get_realtime_warmup());
+#endif
+        run();
+    }
+
     notify();
     reset_cycle();
 
@@ -289,20 +754,18 @@ void io::process(const std::map<string_type, sample_type *>& receives, const std
     async::wait_job([&] {
         auto node_lock = debug_get_lock(node_mutex);
 
+        domain->begin_cycle();
         init_cycle();
 
         log_trace("IO node is setting up output buffers");
-        for(auto&& name : audio.get_output_names()) {
-            auto output = audio.get_output(name);
-            auto user_buffer = receives.find(name);
-            auto buffer = audio::buffer::make();
+        for(auto&& output : audio.get_outputs()) {
+            auto user_buffer = receives.find(output->name);
 
             if (user_buffer == receives.end()) {
-                system_fault("could not find user supplied buffer for IO output: ", name);
+                system_fault("could not find user supplied buffer for IO output: ", output->name);
             }
 
-            buffer->init(domain->buffer_size, user_buffer->second);
-            output->set_buffer(buffer);
+            output->set_external_buffer(user_buffer->second);
         }
     });
 
@@ -317,14 +780,13 @@ void io::process(const std::map<string_type, sample_type *>& receives, const std
     async::wait_job([&] {
         auto node_lock = debug_get_lock(node_mutex);
 
-        for(auto&& name : audio.get_input_names()) {
+        for(auto&& input : audio.get_inputs()) {
             auto buffer_size = domain->buffer_size;
-            auto input = audio.get_input(name);
-            auto user_buffer = sends.find(name);
+            auto user_buffer = sends.find(input->name);
             auto channel_buffer = input->get_buffer();
 
             if (user_buffer == sends.end()) {
-                system_fault("could not find user supplied buffer for IO input: ", name);
+                system_fault("could not find user supplied buffer for IO input: ", input->name);
             }
 
             audio::util::pcm_set(user_buffer->second, channel_buffer->get_pointer(), buffer_size);
@@ -18,6 +18,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include <pulsar/audio.h>
 #include <pulsar/domain.h>
@@ -25,11 +26,15 @@
 #include <pulsar/property.h>
 #include <pulsar/system.h>
 #include <pulsar/thread.h>
+#include <pulsar/util.h>
 
 #ifdef CONFIG_ENABLE_DBUS
 #include <pulsar/dbus.h>
 #endif
 
+#define PULSAR_NODE_CACHE_LINE_SIZE 64
+#define PULSAR_NODE_VALUES_PER_BLOCK (PULSAR_NODE_CACHE_LINE_SIZE / sizeof(property::value_container))
+
 namespace pulsar {
 
 namespace node {
@@ -86,16 +91,35 @@ void init();
 string_type fully_qualify_property_name(const string_type& name_in);
 base * make_chain_node(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in);
 size_type next_node_id();
+void init_nodes(const std::vector<base *>& nodes_in);
+
+struct alignas(PULSAR_NODE_CACHE_LINE_SIZE) value_block {
+    property::value_container values[PULSAR_NODE_VALUES_PER_BLOCK];
+};
 
 #ifdef CONFIG_ENABLE_DBUS
-struct dbus_node : public ::audio::pulsar::node_adaptor, public DBus::IntrospectableAdaptor, public DBus::ObjectAdaptor {
+struct dbus_subscription {
+    property::storage * storage;
+    size_type count = 0;
+    bool sent = false;
+    property::value_container last_sent;
+};
+
+struct dbus_node : public ::audio::pulsar::node_adaptor, public DBus::IntrospectableAdaptor, public DBus::ObjectAdaptor, public dbus::notify_source {
     base * parent;
+    mutex_type subscription_mutex;
+    std::map<string_type, dbus_subscription> subscriptions;
 
     dbus_node(base * parent_in, const std::string& path_in);
+    virtual ~dbus_node();
+    virtual void subscribe(const std::vector<std::string>& names_in) override;
+    virtual void unsubscribe(const std::vector<std::string>& names_in) override;
+    virtual void send_notifications() override;
     virtual std::vector<std::string> property_names() override;
     virtual std::map<std::string, std::string> properties() override;
     virtual std::string peek(const std::string& name_in) override;
     virtual void poke(const std::string& name_in, const std::string& value_in) override;
+    virtual void poke_many(const std::map<std::string, std::string>& values_in) override;
 };
 #endif
 
@@ -104,8 +128,10 @@ struct base {
     friend audio::input * audio::component::add_input(const string_type& name_in);
     friend audio::output * audio::component::add_output(const string_type& name_in);
     friend base * config::make_chain_node(const YAML::Node& node_yaml_in, const YAML::Node& chain_yaml_in, std::shared_ptr<pulsar::config::domain> config_in, std::shared_ptr<pulsar::domain> domain_in);
+    friend config::graph;
     // FIXME only run() is needed but run() is static and friend didn't like that
     friend pulsar::domain;
+    friend property::property;
 #ifdef CONFIG_ENABLE_DBUS
     friend dbus_node;
 #endif
@@ -115,12 +141,39 @@ struct base {
     std::list<dbus_node *> dbus_nodes{0, nullptr};
 #endif
     mutex_type node_mutex;
+    // strings are never used by a running node so they get their own
+    // lock and reading them does not wait for a cycle to finish
+    mutex_type string_mutex;
+    // odd while the published values are being written; a reader that
+    // sees the same even number before and after reading them got
+    // values that all came from the same cycle
+    std::atomic<size_type> snapshot_sequence = ATOMIC_VAR_INIT(0);
+    // counted by the domain so links are only changed between cycles
+    bool in_cycle = false;
+#ifdef CONFIG_REALTIME_CHECK
+    size_type cycles_executed = 0;
+#endif
     std::shared_ptr<pulsar::domain> domain;
     // FIXME pointer because I can't figure out how to make emplace() work
     std::map<string_type, property::property> properties;
+    // the properties in the order they were added; the map never
+    // moves an element so these stay valid for the life of the node
+    std::vector<property::property *> property_list;
+    // the live values of the numeric properties in one cache line
+    // aligned array made once all of them have been added; shared with
+    // the storage that points into it so a property a chain shares
+    // keeps its value after this node is gone
+    std::shared_ptr<std::vector<value_block>> packed_values;
+    // numeric values owned by this node that get published at the
+    // end of every cycle
+    std::vector<property::storage *> published_storage;
+    // bindings with a source this node writes; they are run once the
+    // node is done with a cycle
+    std::vector<property::binding *> bindings;
     base(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in, const bool is_forwarder_in = false);
 #ifdef CONFIG_ENABLE_DBUS
     void add_dbus(const std::string path_in);
+    void remove_dbus();
 #endif
     // needs to be reachable by templated factory methods
     public:
@@ -132,10 +185,13 @@ struct base {
     virtual void input_ready() = 0;
     virtual void notify();
     virtual void reset_cycle();
+    void publish_properties();
+    void run_bindings();
     virtual void stop();
     virtual void deactivate();
     virtual void execute() = 0;
 
+    void pack_values();
     property::property& add_property(const string_type& name_in, const property::value_type& type_in);
     property::property& add_property(const string_type& name_in, const property::property& property_in);
 
@@ -145,21 +201,52 @@ struct base {
     const bool is_forwarder = false;
     audio::component audio;
     virtual ~base();
-    std::shared_ptr<pulsar::domain> get_domain();
+    const std::shared_ptr<pulsar::domain>& get_domain();
     const std::map<string_type, property::property>& get_properties();
     property::property& get_property(const string_type& name_in);
+    property::property& get_property(const size_type index_in);
+    size_type get_property_index(const string_type& name_in);
+    size_type get_num_properties();
+    util::span<property::property *> get_property_list();
     string_type peek(const string_type& name_in);
+    std::vector<std::pair<property::property *, property::value_container>> snapshot_numbers();
+    std::map<string_type, string_type> snapshot();
     void poke(const string_type& name_in, const string_type& value_in);
+    void poke_many(const std::map<string_type, string_type>& values_in);
+    property::update make_update(const string_type& name_in, const string_type& value_in);
     virtual void init();
     virtual bool is_ready();
+    // plugin state that is not held in properties; empty when the node
+    // has none
+    virtual string_type save_state();
+    virtual void restore_state(const string_type& state_in);
+    // the files the ports of the node come from so a cache of how the
+    // node was built can tell when it is out of date
+    virtual std::vector<string_type> get_plugin_files();
+    // why init() would fault with the properties as they are set now so
+    // a reload can refuse the node instead; empty if it would not
+    virtual string_type get_init_problem();
 };
 
 class filter : public base {
     protected:
+    // set by filters that implement run_block() so smoothed values
+    // can be moved between pieces of the buffer
+    bool can_split_run = false;
+    std::vector<property::storage *> smoothed_storage;
+    // values that can change part way through the buffer
+    std::vector<property::storage *> timed_storage;
     filter(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in);
     virtual void execute() override;
     virtual void input_ready() override;
-    virtual void run() = 0;
+    virtual void run();
+    virtual void run_block(const size_type offset_in, const size_type length_in);
+    size_type step_ramps(const size_type length_in);
+    size_type next_scheduled(const size_type offset_in);
+    void apply_scheduled(const size_type offset_in);
+
+    public:
+    virtual void activate() override;
 };
 
 class io : public base {
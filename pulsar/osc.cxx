@@ -0,0 +1,402 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#include <arpa/inet.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <endian.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <pulsar/logging.h>
+#include <pulsar/osc.h>
+#include <pulsar/system.h>
+
+namespace pulsar {
+
+namespace osc {
+
+void init()
+{
+    library::register_daemon_factory("pulsar::osc::server", make_server);
+}
+
+std::shared_ptr<server> make_server(const string_type& name_in)
+{
+    return std::make_shared<server>(name_in);
+}
+
+// OSC strings are null terminated and padded out to 4 bytes; returns
+// the number of bytes used or 0 if the string ran off the end
+static size_type read_string(const char * data_in, const size_type size_in, string_type& string_out)
+{
+    auto end = static_cast<const char *>(memchr(data_in, '\0', size_in));
+
+    if (end == nullptr) {
+        return 0;
+    }
+
+    auto length = static_cast<size_type>(end - data_in);
+    auto padded = (length + 4) & ~static_cast<size_type>(3);
+
+    if (padded > size_in) {
+        return 0;
+    }
+
+    string_out.assign(data_in, length);
+    return padded;
+}
+
+static uint32_t read_uint32(const char * data_in)
+{
+    uint32_t value;
+    memcpy(&value, data_in, sizeof(value));
+    return be32toh(value);
+}
+
+static uint64_t read_uint64(const char * data_in)
+{
+    uint64_t value;
+    memcpy(&value, data_in, sizeof(value));
+    return be64toh(value);
+}
+
+static void set_value(property::value_container& value_in, const property::value_type type_in, const double number_in)
+{
+    switch(type_in) {
+        case property::value_type::unknown: system_fault("parameter type was not known");
+        case property::value_type::size: value_in.size = number_in; return;
+        case property::value_type::integer: value_in.integer = number_in; return;
+        case property::value_type::real: value_in.real = number_in; return;
+        case property::value_type::string: system_fault("string values can not be set from a number");
+    }
+}
+
+server::server(const string_type& name_in)
+: daemon::base(name_in)
+{ }
+
+server::~server()
+{
+    if (running) {
+        stop();
+    }
+}
+
+void server::init(const YAML::Node& yaml_in)
+{
+    log_debug("initializing OSC server ", name);
+
+    if (! yaml_in) {
+        return;
+    }
+
+    if (yaml_in["address"]) {
+        bind_address = yaml_in["address"].as<string_type>();
+    }
+
+    if (yaml_in["port"]) {
+        port = yaml_in["port"].as<size_type>();
+    }
+
+    if (yaml_in["domain"]) {
+        domain_name = yaml_in["domain"].as<string_type>();
+    }
+}
+
+void server::start()
+{
+    assert(! running);
+
+    for(auto&& i : get_domains()) {
+        if (domain_name == "" || i->name == domain_name) {
+            domain = i;
+            break;
+        }
+    }
+
+    if (domain == nullptr) {
+        system_fault("OSC server ", name, " could not find domain ", domain_name);
+    }
+
+    socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (socket_fd < 0) {
+        system_fault("could not create OSC socket: ", strerror(errno));
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, bind_address.c_str(), &address.sin_addr) != 1) {
+        system_fault("invalid OSC listen address: ", bind_address);
+    }
+
+    if (bind(socket_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address))) {
+        system_fault("could not bind OSC socket to ", bind_address, ":", port, ": ", strerror(errno));
+    }
+
+    // wake up every so often to see if the server is being stopped
+    timeval timeout{};
+    timeout.tv_usec = PULSAR_OSC_RECEIVE_TIMEOUT_MS * 1000;
+
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout))) {
+        system_fault("could not set OSC socket timeout: ", strerror(errno));
+    }
+
+    packet.resize(PULSAR_OSC_MAX_PACKET_SIZE);
+    batch.reserve(PULSAR_DOMAIN_UPDATE_QUEUE_SIZE);
+
+    log_info("OSC server ", name, " is listening on ", bind_address, ":", port);
+
+    running = true;
+    receive_thread = new thread_type(&server::receive_loop, this);
+}
+
+void server::stop()
+{
+    log_info("stopping OSC server ", name);
+
+    running = false;
+
+    if (receive_thread != nullptr) {
+        receive_thread->join();
+        delete receive_thread;
+        receive_thread = nullptr;
+    }
+
+    if (socket_fd >= 0) {
+        close(socket_fd);
+        socket_fd = -1;
+    }
+}
+
+void server::receive_loop()
+{
+    while(running) {
+        auto received = recv(socket_fd, packet.data(), packet.size(), 0);
+
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                continue;
+            }
+
+            system_fault("could not receive from OSC socket: ", strerror(errno));
+        }
+
+        pulsar::domain::update_guard guard(*domain);
+
+        batch.clear();
+        handle_packet(packet.data(), received);
+
+        if (batch.size() > 0) {
+            domain->submit_updates(batch);
+        }
+    }
+}
+
+// a bundle is "#bundle", a time tag, then any number of elements that
+// each have a size in front of them; the time tag is not used
+void server::handle_packet(const char * data_in, const size_type size_in)
+{
+    if (size_in < 8 || strncmp(data_in, "#bundle", 8) != 0) {
+        handle_message(data_in, size_in);
+        return;
+    }
+
+    size_type offset = 16;
+
+    while(offset + 4 <= size_in) {
+        auto element_size = read_uint32(data_in + offset);
+        offset += 4;
+
+        if (element_size > size_in - offset) {
+            log_error("OSC server ", name, " got a bundle element that was too large");
+            return;
+        }
+
+        handle_packet(data_in + offset, element_size);
+        offset += element_size;
+    }
+}
+
+void server::handle_message(const char * data_in, const size_type size_in)
+{
+    string_type address, type_tags;
+    auto offset = read_string(data_in, size_in, address);
+
+    if (offset == 0) {
+        log_error("OSC server ", name, " got a message with an invalid address");
+        return;
+    }
+
+    auto tags_size = read_string(data_in + offset, size_in - offset, type_tags);
+
+    if (tags_size == 0 || type_tags.size() != 2 || type_tags[0] != ',') {
+        log_error("OSC server ", name, " message for ", address, " did not have exactly one argument");
+        return;
+    }
+
+    offset += tags_size;
+
+    auto found = find_target(address);
+
+    if (found.property == nullptr) {
+        return;
+    }
+
+    auto& storage = found.property->value;
+    auto argument = data_in + offset;
+    auto remaining = size_in - offset;
+    double number = 0;
+    size_type needed = 0;
+
+    switch(type_tags[1]) {
+        case 'i': case 'f': needed = 4; break;
+        case 'h': case 'd': needed = 8; break;
+    }
+
+    if (remaining < needed) {
+        log_error("OSC server ", name, " got a truncated argument for ", address);
+        return;
+    }
+
+    switch(type_tags[1]) {
+        case 'T': number = 1; break;
+        case 'F': number = 0; break;
+        case 'i':
+            number = static_cast<int32_t>(read_uint32(argument));
+            break;
+        case 'f': {
+            auto bits = read_uint32(argument);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            number = value;
+            break;
+        }
+        case 'h':
+            number = static_cast<int64_t>(read_uint64(argument));
+            break;
+        case 'd': {
+            auto bits = read_uint64(argument);
+            memcpy(&number, &bits, sizeof(number));
+            break;
+        }
+        case 's': {
+            string_type value;
+
+            if (read_string(argument, remaining, value) == 0) {
+                log_error("OSC server ", name, " got an invalid string for ", address);
+                return;
+            }
+
+            auto update = found.node->make_update(found.property->name, value);
+
+            if (update.target != nullptr) {
+                add_update(update);
+            }
+
+            return;
+        }
+        default:
+            log_error("OSC server ", name, " does not support argument type ", type_tags[1], " for ", address);
+            return;
+    }
+
+    if (storage->type == property::value_type::string) {
+        log_error("OSC server ", name, " can only set ", address, " from a string");
+        return;
+    }
+
+    property::update update{};
+    update.target = storage.get();
+    set_value(update.value, storage->type, number);
+    add_update(update);
+}
+
+// a bundle bigger than the update queue can not go in as one batch
+void server::add_update(const property::update& update_in)
+{
+    if (batch.size() == PULSAR_DOMAIN_UPDATE_QUEUE_SIZE) {
+        log_error("OSC server ", name, " got more updates than fit in a single cycle");
+        domain->submit_updates(batch);
+        batch.clear();
+    }
+
+    batch.push_back(update_in);
+}
+
+// addresses are looked up once and then remembered; an address that
+// does not match anything is not remembered so a typo does not grow
+// the cache forever
+target server::find_target(const string_type& address_in)
+{
+    auto version = domain->get_topology_version();
+
+    if (version != cache_version) {
+        address_cache.clear();
+        cache_version = version;
+    }
+
+    auto found = address_cache.find(address_in);
+
+    if (found != address_cache.end()) {
+        return found->second;
+    }
+
+    auto prefix_length = strlen(PULSAR_OSC_NODE_PREFIX);
+
+    if (address_in.compare(0, prefix_length, PULSAR_OSC_NODE_PREFIX) != 0) {
+        log_error("OSC server ", name, " got unknown address ", address_in);
+        return target{};
+    }
+
+    auto separator = address_in.find('/', prefix_length);
+
+    if (separator == string_type::npos) {
+        log_error("OSC server ", name, " got an address without a property name: ", address_in);
+        return target{};
+    }
+
+    auto node_name = address_in.substr(prefix_length, separator - prefix_length);
+    auto property_name = node::fully_qualify_property_name(address_in.substr(separator + 1));
+    auto target_node = domain->find_node(node_name);
+
+    if (target_node == nullptr) {
+        log_error("OSC server ", name, " got an address for unknown node ", node_name);
+        return target{};
+    }
+
+    auto& properties = target_node->get_properties();
+    auto found_property = properties.find(property_name);
+
+    if (found_property == properties.end()) {
+        log_error("OSC server ", name, " got an address for unknown property ", property_name, " of node ", node_name);
+        return target{};
+    }
+
+    target new_target;
+    new_target.node = target_node;
+    new_target.property = const_cast<property::property *>(&found_property->second);
+
+    address_cache[address_in] = new_target;
+
+    return new_target;
+}
+
+} // namespace osc
+
+} // namespace pulsar
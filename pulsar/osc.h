@@ -0,0 +1,82 @@
+// Pulsar Audio Engine
+// Copyright 2019 Tyler Riddle <kg7oem@gmail.com>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <pulsar/daemon.h>
+#include <pulsar/domain.h>
+#include <pulsar/library.h>
+#include <pulsar/node.h>
+#include <pulsar/property.h>
+#include <pulsar/thread.h>
+#include <pulsar/types.h>
+
+#define PULSAR_OSC_DEFAULT_ADDRESS "127.0.0.1"
+#define PULSAR_OSC_DEFAULT_PORT 9000
+// largest UDP datagram that will be accepted
+#define PULSAR_OSC_MAX_PACKET_SIZE 65536
+// how often the receive thread checks if it should stop
+#define PULSAR_OSC_RECEIVE_TIMEOUT_MS 100
+// the first part of every OSC address that sets a property
+#define PULSAR_OSC_NODE_PREFIX "/node/"
+
+namespace pulsar {
+
+namespace osc {
+
+struct target {
+    node::base * node = nullptr;
+    property::property * property = nullptr;
+};
+
+// property updates arrive as /node/<node name>/<property name> with a
+// single argument; every message in a bundle lands in the same cycle
+class server : public daemon::base {
+    string_type bind_address = PULSAR_OSC_DEFAULT_ADDRESS;
+    size_type port = PULSAR_OSC_DEFAULT_PORT;
+    string_type domain_name;
+    std::shared_ptr<pulsar::domain> domain;
+    int socket_fd = -1;
+    std::atomic<bool> running = ATOMIC_VAR_INIT(false);
+    thread_type * receive_thread = nullptr;
+    // only used by the receive thread
+    std::vector<char> packet;
+    std::vector<property::update> batch;
+    std::map<string_type, target> address_cache;
+    // the cache is thrown away when nodes are added or removed
+    size_type cache_version = 0;
+    void receive_loop();
+    void handle_packet(const char * data_in, const size_type size_in);
+    void handle_message(const char * data_in, const size_type size_in);
+    void add_update(const property::update& update_in);
+    target find_target(const string_type& address_in);
+
+    public:
+    server(const string_type& name_in);
+    virtual ~server();
+    virtual void init(const YAML::Node& yaml_in) override;
+    virtual void start() override;
+    virtual void stop() override;
+};
+
+void init();
+std::shared_ptr<server> make_server(const string_type& name_in);
+
+} // namespace osc
+
+} // namespace pulsar
@@ -11,9 +11,13 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU Lesser General Public License for more details.
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <cstdlib>
 
 #include <pulsar/logging.h>
+#include <pulsar/node.h>
 #include <pulsar/property.h>
 #include <pulsar/system.h>
 
@@ -21,39 +25,234 @@ namespace pulsar {
 
 namespace property {
 
+bool find_smoothing_type(const string_type& name_in, smoothing_type& type_out)
+{
+    if (name_in == "none") {
+        type_out = smoothing_type::none;
+    } else if (name_in == "linear") {
+        type_out = smoothing_type::linear;
+    } else if (name_in == "exponential") {
+        type_out = smoothing_type::exponential;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+smoothing_type smoothing_type_from_name(const string_type& name_in)
+{
+    smoothing_type retval;
+
+    if (! find_smoothing_type(name_in, retval)) {
+        system_fault("unknown smoothing type: ", name_in);
+    }
+
+    return retval;
+}
+
+string_type to_string(const value_type& type_in, const value_container& value_in)
+{
+    switch(type_in) {
+        case value_type::unknown: system_fault("parameter type was not known");
+        case value_type::size: return std::to_string(value_in.size);
+        case value_type::integer: return std::to_string(value_in.integer);
+        case value_type::real: return std::to_string(value_in.real);
+        case value_type::string: system_fault("string values are not held in a value container");
+    }
+
+    system_fault("should never get out of switch statement");
+}
+
 storage::storage(const value_type& type_in)
-: type(type_in)
+: value(&own_value), type(type_in)
 {
     switch(type) {
         case value_type::unknown: system_fault("can not specify unknown as a parameter type");
-        case value_type::size: value.size = 0; break;
-        case value_type::integer: value.integer = 0; break;
-        case value_type::real: value.real = 0; break;
-        case value_type::string: value.string = new string_type; break;
+        case value_type::size: value->size = 0; break;
+        case value_type::integer: value->integer = 0; break;
+        case value_type::real: value->real = 0; break;
+        case value_type::string: value->string = new string_type; break;
     }
+
+    // nothing can be reading it yet
+    publish();
 }
 
 storage::~storage()
 {
-    if (type == value_type::string && value.string != nullptr) {
-        delete(value.string);
-        value.string = nullptr;
+    if (type == value_type::string && value->string != nullptr) {
+        delete(value->string);
+        value->string = nullptr;
     }
 }
 
+// done before anything holds on to the address of the value
+void storage::move_value(value_container * slot_in, std::shared_ptr<void> owner_in)
+{
+    assert(type != value_type::string);
+
+    *slot_in = *value;
+    value = slot_in;
+    value_owner = owner_in;
+}
+
+// numeric values come from the published copy so this is safe to
+// call while the node is running but strings are not
 string_type storage::get()
 {
+    if (type == value_type::string) {
+        return *value->string;
+    }
+
+    return to_string(type, published.load());
+}
+
+value_container storage::parse(const string_type& value_in)
+{
+    auto c_str = value_in.c_str();
+    value_container retval;
+
     switch(type) {
         case value_type::unknown: system_fault("parameter type was not known");
-        case value_type::size: return std::to_string(value.size);
-        case value_type::integer: return std::to_string(value.integer);
-        case value_type::real: return std::to_string(value.real);
-        case value_type::string: return *value.string;
+        case value_type::size: retval.size = std::strtoul(c_str, nullptr, 0); return retval;
+        case value_type::integer: retval.integer = std::atoi(c_str); return retval;
+        case value_type::real: retval.real = std::strtof(c_str, nullptr); return retval;
+        case value_type::string: system_fault("string values can not be parsed into a value container");
     }
 
     system_fault("should never get out of switch statement");
 }
 
+// a smoothed value is not changed here; the node moves it toward
+// the new value a piece at a time while it runs
+void storage::apply(const value_container& value_in)
+{
+    assert(type != value_type::string);
+
+    if (smoothing_settings.type != smoothing_type::none && smoothing_settings.length > 0) {
+        ramp_target = value_in.real;
+        ramp_step = (ramp_target - value->real) / smoothing_settings.length;
+        ramp_remaining = smoothing_settings.length;
+        return;
+    }
+
+    *value = value_in;
+}
+
+// a value for later in the cycle waits until the node gets to that
+// sample; values with the same offset are applied in the order they
+// were scheduled and if there is no more room the earliest one is
+// applied now
+void storage::apply(const value_container& value_in, const size_type offset_in)
+{
+    if (offset_in == 0 || ! timed) {
+        apply(value_in);
+        return;
+    }
+
+    if (num_scheduled == scheduled.size()) {
+        apply_scheduled();
+    }
+
+    auto position = num_scheduled;
+
+    while(position > 0 && scheduled[position - 1].offset > offset_in) {
+        scheduled[position] = scheduled[position - 1];
+        position--;
+    }
+
+    scheduled[position].offset = offset_in;
+    scheduled[position].value = value_in;
+    num_scheduled++;
+}
+
+void storage::set_timed(const bool timed_in)
+{
+    timed = timed_in;
+}
+
+bool storage::is_scheduled()
+{
+    return num_scheduled > 0;
+}
+
+// the offset of the next value to be applied
+size_type storage::get_scheduled_offset()
+{
+    assert(num_scheduled > 0);
+
+    return scheduled[0].offset;
+}
+
+void storage::apply_scheduled()
+{
+    assert(num_scheduled > 0);
+
+    auto next = scheduled[0].value;
+
+    std::copy(scheduled.begin() + 1, scheduled.begin() + num_scheduled, scheduled.begin());
+    num_scheduled--;
+
+    apply(next);
+}
+
+// only the node that owns the value calls this while it holds its
+// snapshot sequence odd so a snapshot never mixes values from two
+// cycles; anything set before the node is activated is published
+// when the node is activated
+void storage::publish()
+{
+    published.store(*value);
+}
+
+value_container storage::get_published()
+{
+    return published.load();
+}
+
+void storage::set_smoothing(const smoothing& smoothing_in)
+{
+    if (type != value_type::real && smoothing_in.type != smoothing_type::none) {
+        system_fault("only real values can be smoothed");
+    }
+
+    smoothing_settings = smoothing_in;
+}
+
+const smoothing& storage::get_smoothing()
+{
+    return smoothing_settings;
+}
+
+bool storage::is_ramping()
+{
+    return ramp_remaining > 0;
+}
+
+// move the value along the ramp by the given number of samples; the
+// exponential ramp has covered 99% of the distance when the length
+// of the ramp is up and then lands on the target
+void storage::step_ramp(const size_type samples_in)
+{
+    assert(ramp_remaining > 0);
+
+    if (samples_in >= ramp_remaining) {
+        value->real = ramp_target;
+        ramp_remaining = 0;
+        return;
+    }
+
+    if (smoothing_settings.type == smoothing_type::linear) {
+        value->real += ramp_step * samples_in;
+    } else {
+        auto time_constant = smoothing_settings.length / std::log(100.0);
+        value->real += (ramp_target - value->real) * (1 - std::exp(-(samples_in / time_constant)));
+    }
+
+    ramp_remaining -= samples_in;
+}
+
 void storage::set(const double& value_in)
 {
     switch(type) {
@@ -69,27 +268,22 @@ void storage::set(const double& value_in)
 
 void storage::set(const string_type& value_in)
 {
-    auto c_str = value_in.c_str();
-
-    switch(type) {
-        case value_type::unknown: system_fault("parameter type was not known");
-        case value_type::size: value.size = std::strtoul(c_str, nullptr, 0); return;
-        case value_type::integer: value.integer = std::atoi(c_str); return;
-        case value_type::real: value.real = std::strtof(c_str, nullptr); return;
-        case value_type::string: *value.string = value_in; return;
+    if (type == value_type::string) {
+        *value->string = value_in;
+        return;
     }
 
-    system_fault("should never get out of switch statement");
+    apply(parse(value_in));
 }
 
 void storage::set(const YAML::Node& value_in)
 {
     switch(type) {
         case value_type::unknown: system_fault("parameter type was not known");
-        case value_type::size: value.size = value_in.as<size_type>(); return;
-        case value_type::integer: value.integer = value_in.as<integer_type>(); return;
-        case value_type::real: value.real = value_in.as<real_type>(); return;
-        case value_type::string: *value.string = value_in.as<string_type>(); return;
+        case value_type::size: value->size = value_in.as<size_type>(); break;
+        case value_type::integer: value->integer = value_in.as<integer_type>(); break;
+        case value_type::real: value->real = value_in.as<real_type>(); break;
+        case value_type::string: *value->string = value_in.as<string_type>(); return;
     }
 }
 
@@ -99,7 +293,7 @@ size_type& storage::get_size()
         system_fault("parameter is not of type: size");
     }
 
-    return value.size;
+    return value->size;
 }
 
 void storage::set_size(const size_type& size_in)
@@ -108,7 +302,7 @@ void storage::set_size(const size_type& size_in)
         system_fault("parameter is not of type: size");
     }
 
-    value.size = size_in;
+    value->size = size_in;
 }
 
 integer_type& storage::get_integer()
@@ -117,7 +311,7 @@ integer_type& storage::get_integer()
         system_fault("parameter is not of type: integer");
     }
 
-    return value.integer;
+    return value->integer;
 }
 
 void storage::set_integer(const integer_type& integer_in)
@@ -126,7 +320,7 @@ void storage::set_integer(const integer_type& integer_in)
         system_fault("parameter is not of type: integer");
     }
 
-    value.integer = integer_in;
+    value->integer = integer_in;
 }
 
 void storage::set_real(const real_type& real_in)
@@ -135,7 +329,7 @@ void storage::set_real(const real_type& real_in)
         system_fault("parameter is not of type: real");
     }
 
-    value.real = real_in;
+    value->real = real_in;
 }
 
 real_type& storage::get_real()
@@ -144,7 +338,7 @@ real_type& storage::get_real()
         system_fault("parameter is not of type: real");
     }
 
-    return value.real;
+    return value->real;
 }
 
 void storage::set_string(const string_type& string_in)
@@ -153,7 +347,7 @@ void storage::set_string(const string_type& string_in)
         system_fault("parameter is not of type: string");
     }
 
-    *value.string = string_in;
+    *value->string = string_in;
 }
 
 string_type& storage::get_string()
@@ -162,17 +356,93 @@ string_type& storage::get_string()
         system_fault("parameter is not of type: string");
     }
 
-    return *value.string;
+    return *value->string;
 }
 
-property::property(node::base * parent_in, const string_type& name_in, const value_type type_in)
-: parent(parent_in), name(name_in), value(std::make_shared<storage>(type_in))
+property::property(node::base * parent_in, const string_type& name_in, const size_type id_in, const value_type type_in)
+: parent(parent_in), name(name_in), id(id_in), value(std::make_shared<storage>(type_in))
 { }
 
-property::property(node::base * parent_in, const string_type& name_in, std::shared_ptr<storage> storage_in)
-: parent(parent_in), name(name_in), value(storage_in)
+property::property(node::base * parent_in, const string_type& name_in, const size_type id_in, std::shared_ptr<storage> storage_in)
+: parent(parent_in), name(name_in), id(id_in), value(storage_in)
 { }
 
+conversion conversion_from_name(const string_type& name_in)
+{
+    if (name_in == "none") {
+        return conversion::none;
+    } else if (name_in == "db_to_linear") {
+        return conversion::db_to_linear;
+    } else if (name_in == "linear_to_db") {
+        return conversion::linear_to_db;
+    }
+
+    system_fault("unknown conversion: ", name_in);
+}
+
+// called by the node that owns the source right after it ran so the
+// live value is read instead of the published one
+real_type binding::evaluate()
+{
+    real_type input = 0;
+
+    switch(source->type) {
+        case value_type::size: input = source->get_size(); break;
+        case value_type::integer: input = source->get_integer(); break;
+        case value_type::real: input = source->get_real(); break;
+        default: system_fault("binding source must be a number");
+    }
+
+    switch(convert) {
+        case conversion::none: break;
+        case conversion::db_to_linear: input = std::pow(10, input / 20); break;
+        case conversion::linear_to_db: input = 20 * std::log10(std::max(input, std::numeric_limits<real_type>::min())); break;
+    }
+
+    input = std::min(std::max(input * scale + offset, min), max);
+
+    if (! has_value) {
+        has_value = true;
+        current = input;
+    } else {
+        current += (input - current) * smoothing_coefficient;
+    }
+
+    return current;
+}
+
+// only a value that changed turns into an update; it is not counted as
+// sent until mark_sent() is called so an update that did not fit in
+// the queue is made again next cycle
+bool binding::make_update(update& update_out)
+{
+    auto value = evaluate();
+
+    if (has_sent && value == last_sent) {
+        return false;
+    }
+
+    pending = value;
+
+    update_out = update{};
+    update_out.target = target;
+
+    switch(target->type) {
+        case value_type::size: update_out.value.size = std::lround(std::max(value, real_type(0))); break;
+        case value_type::integer: update_out.value.integer = std::lround(value); break;
+        case value_type::real: update_out.value.real = value; break;
+        default: system_fault("binding target must be a number");
+    }
+
+    return true;
+}
+
+void binding::mark_sent()
+{
+    has_sent = true;
+    last_sent = pending;
+}
+
 } // namespace parameter
 
 } // namespace pulsar
@@ -13,6 +13,9 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <limits>
 #include <memory>
 #include <string>
 
@@ -20,11 +23,26 @@
 #include <pulsar/node.forward.h>
 #include <pulsar/system.h>
 
+// how many values a property can have waiting for a later sample in
+// a single cycle
+#define PULSAR_PROPERTY_MAX_SCHEDULED 8
+
 namespace pulsar {
 
 namespace property {
 
 enum class value_type { unknown, size, integer, real, string };
+enum class smoothing_type { none, linear, exponential };
+
+// how a real value moves to a new value once it is applied; the
+// length is the number of samples the ramp takes
+struct smoothing {
+    smoothing_type type = smoothing_type::none;
+    size_type length = 0;
+};
+
+bool find_smoothing_type(const string_type& name_in, smoothing_type& type_out);
+smoothing_type smoothing_type_from_name(const string_type& name_in);
 
 union value_container {
     size_type size;
@@ -33,17 +51,71 @@ union value_container {
     string_type * string;
 };
 
+class storage;
+
+// a new value for a property that is waiting to be applied at the
+// start of the next cycle of the domain; updates submitted together
+// share a batch id and are only applied once all of them arrived
+struct update {
+    storage * target;
+    value_container value;
+    // the sample in the cycle the value takes effect at
+    size_type offset;
+    size_type batch_id;
+    size_type batch_remaining;
+};
+
+string_type to_string(const value_type& type_in, const value_container& value_in);
+
 class storage : public std::enable_shared_from_this<storage> {
     storage(const storage&) = delete;
 
     protected:
-    value_container value;
+    // this is what plugins read and write while they run; it is only
+    // changed between cycles. Once the node is initialized it points
+    // into the packed values of the node which value_owner keeps alive
+    value_container * value;
+    std::shared_ptr<void> value_owner;
+    // used for strings and until the node packs its values
+    value_container own_value;
+    // a copy of the numeric value made at the end of every cycle so
+    // any thread can read it without a lock
+    std::atomic<value_container> published;
+    smoothing smoothing_settings;
+    real_type ramp_target = 0;
+    real_type ramp_step = 0;
+    size_type ramp_remaining = 0;
+    // set by nodes that can run part of a buffer so a value can be
+    // changed at the sample it was scheduled for
+    bool timed = false;
+    // values waiting for later in the cycle ordered by their offset;
+    // a fixed size so scheduling never allocates in the audio thread
+    struct scheduled_value {
+        size_type offset;
+        value_container value;
+    };
+    std::array<scheduled_value, PULSAR_PROPERTY_MAX_SCHEDULED> scheduled;
+    size_type num_scheduled = 0;
 
     public:
     const value_type type = value_type::unknown;
     storage(const value_type& type_in);
     virtual ~storage();
     string_type get();
+    value_container parse(const string_type& value_in);
+    void move_value(value_container * slot_in, std::shared_ptr<void> owner_in);
+    void apply(const value_container& value_in);
+    void apply(const value_container& value_in, const size_type offset_in);
+    void set_timed(const bool timed_in);
+    bool is_scheduled();
+    size_type get_scheduled_offset();
+    void apply_scheduled();
+    void publish();
+    value_container get_published();
+    void set_smoothing(const smoothing& smoothing_in);
+    const smoothing& get_smoothing();
+    bool is_ramping();
+    void step_ramp(const size_type samples_in);
     void set(const double& value_in);
     void set(const string_type& value_in);
     void set(const YAML::Node& value_in);
@@ -57,15 +129,51 @@ class storage : public std::enable_shared_from_this<storage> {
     void set_string(const string_type& string_in);
 };
 
+enum class conversion {
+    none,
+    db_to_linear,
+    linear_to_db,
+};
+
+conversion conversion_from_name(const string_type& name_in);
+
+// carries the value of one property to another once per cycle; the
+// source value is converted, then scaled and offset, then clamped and
+// last smoothed across cycles
+struct binding {
+    storage * source = nullptr;
+    storage * target = nullptr;
+    conversion convert = conversion::none;
+    real_type scale = 1;
+    real_type offset = 0;
+    real_type min = -std::numeric_limits<real_type>::infinity();
+    real_type max = std::numeric_limits<real_type>::infinity();
+    // how much of the way to the new value is moved each cycle; 1
+    // means there is no smoothing
+    real_type smoothing_coefficient = 1;
+    bool has_value = false;
+    real_type current = 0;
+    bool has_sent = false;
+    real_type last_sent = 0;
+    // made into an update but not known to be queued yet
+    real_type pending = 0;
+    real_type evaluate();
+    bool make_update(update& update_out);
+    void mark_sent();
+};
+
 class property {
     protected:
     node::base * parent;
 
     public:
     const string_type name;
+    // the position of the property in the node so hot paths can look
+    // it up without a name
+    const size_type id;
     const std::shared_ptr<storage> value;
-    property(node::base * parent_in, const string_type& name_in, const value_type type_in);
-    property(node::base * parent_in, const string_type& name_in, std::shared_ptr<storage> storage_in);
+    property(node::base * parent_in, const string_type& name_in, const size_type id_in, const value_type type_in);
+    property(node::base * parent_in, const string_type& name_in, const size_type id_in, std::shared_ptr<storage> storage_in);
 };
 
 } // namespace property
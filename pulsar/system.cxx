@@ -25,6 +25,10 @@
 #include <pulsar/thread.h>
 #include <pulsar/zeronode.h>
 
+#ifdef CONFIG_ENABLE_ALSA
+#include <pulsar/alsa.h>
+#endif
+
 #ifdef CONFIG_ENABLE_DBUS
 #include <pulsar/dbus.h>
 #endif
@@ -41,6 +45,10 @@
 #include <pulsar/LV2.h>
 #endif
 
+#ifdef CONFIG_ENABLE_OSC
+#include <pulsar/osc.h>
+#endif
+
 #ifdef CONFIG_ENABLE_PORTAUDIO
 #include <pulsar/portaudio.h>
 #endif
@@ -81,6 +89,10 @@ void bootstrap(const size_type num_threads_in)
     pulsar::node::init();
     pulsar::zeronode::init();
 
+#ifdef CONFIG_ENABLE_ALSA
+    pulsar::alsa::init();
+#endif
+
 #ifdef CONFIG_ENABLE_LADSPA
     pulsar::ladspa::init();
 #endif
@@ -93,6 +105,10 @@ void bootstrap(const size_type num_threads_in)
     pulsar::jackaudio::init();
 #endif
 
+#ifdef CONFIG_ENABLE_OSC
+    pulsar::osc::init();
+#endif
+
 #ifdef CONFIG_ENABLE_PORTAUDIO
     pulsar::portaudio::init();
 #endif
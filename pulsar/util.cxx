@@ -11,8 +11,17 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU Lesser General Public License for more details.
 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
 #include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <pulsar/logging.h>
+#include <pulsar/system.h>
 #include <pulsar/util.h>
 
 namespace pulsar {
@@ -27,6 +36,186 @@ std::vector<string_type> split(const string_type& string_in, const char delim_in
     return parts;
 }
 
+// 64 bit FNV-1a; the hash of one piece of data can be passed in to
+// hash several pieces together
+uint64_t hash(const string_type& data_in, uint64_t hash_in)
+{
+    for(auto&& i : data_in) {
+        hash_in ^= static_cast<unsigned char>(i);
+        hash_in *= 1099511628211ULL;
+    }
+
+    return hash_in;
+}
+
+bool read_file(const string_type& path_in, string_type& contents_out)
+{
+    std::ifstream file(path_in, std::ios::binary);
+
+    if (! file) {
+        return false;
+    }
+
+    contents_out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return ! file.bad();
+}
+
+// in nanoseconds; 0 if the file is gone
+size_type get_file_mtime(const string_type& path_in)
+{
+    struct stat info;
+
+    if (stat(path_in.c_str(), &info)) {
+        return 0;
+    }
+
+    return info.st_mtim.tv_sec * 1000000000ULL + info.st_mtim.tv_nsec;
+}
+
+// the contents are written next to the file, flushed to disk then
+// renamed over it so a reader never sees a partly written file even
+// after a crash; failures are logged since the callers only save
+// state and caches which must not take down a running engine
+bool write_file(const string_type& path_in, const string_type& contents_in)
+{
+    auto temp_path = path_in + ".tmp";
+    auto fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd == -1) {
+        log_error("could not open ", temp_path, " for writing: ", strerror(errno));
+        return false;
+    }
+
+    auto data = contents_in.data();
+    auto remaining = contents_in.size();
+
+    while (remaining > 0) {
+        auto written = write(fd, data, remaining);
+
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            log_error("could not write to ", temp_path, ": ", strerror(errno));
+            close(fd);
+            unlink(temp_path.c_str());
+            return false;
+        }
+
+        data += written;
+        remaining -= written;
+    }
+
+    if (fsync(fd)) {
+        log_error("could not sync ", temp_path, ": ", strerror(errno));
+        close(fd);
+        unlink(temp_path.c_str());
+        return false;
+    }
+
+    if (close(fd)) {
+        log_error("could not close ", temp_path, ": ", strerror(errno));
+        unlink(temp_path.c_str());
+        return false;
+    }
+
+    if (std::rename(temp_path.c_str(), path_in.c_str())) {
+        log_error("could not rename ", temp_path, " to ", path_in, ": ", strerror(errno));
+        unlink(temp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void binary_writer::write_size(const size_type size_in)
+{
+    uint64_t value = size_in;
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void binary_writer::write_real(const double real_in)
+{
+    buffer.append(reinterpret_cast<const char *>(&real_in), sizeof(real_in));
+}
+
+void binary_writer::write_string(const string_type& string_in)
+{
+    write_size(string_in.size());
+    buffer.append(string_in);
+}
+
+const string_type& binary_writer::get_buffer()
+{
+    return buffer;
+}
+
+binary_reader::binary_reader(const string_type& buffer_in)
+: buffer(buffer_in)
+{ }
+
+bool binary_reader::read(void * dest_in, const size_type size_in)
+{
+    if (failed || size_in > buffer.size() - position) {
+        failed = true;
+        memset(dest_in, 0, size_in);
+        return false;
+    }
+
+    memcpy(dest_in, buffer.data() + position, size_in);
+    position += size_in;
+    return true;
+}
+
+size_type binary_reader::read_size()
+{
+    uint64_t value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+double binary_reader::read_real()
+{
+    double value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+string_type binary_reader::read_string()
+{
+    auto length = read_size();
+
+    if (failed || length > buffer.size() - position) {
+        failed = true;
+        return "";
+    }
+
+    string_type value(buffer.data() + position, length);
+    position += length;
+    return value;
+}
+
+bool binary_reader::is_failed()
+{
+    return failed;
+}
+
+bool binary_reader::at_end()
+{
+    return position == buffer.size();
+}
+
+real_type stopwatch::get_ms() const
+{
+    return std::chrono::duration<real_type, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+
+void stopwatch::restart()
+{
+    started = std::chrono::steady_clock::now();
+}
+
 } // namespace util
 
 } //namespace pulsar
@@ -13,6 +13,8 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -34,6 +36,72 @@ void split(const string_type &string_in, const char delim_in, Out result) {
 }
 
 std::vector<string_type> split(const string_type& string_in, const char delim_in);
+uint64_t hash(const string_type& data_in, uint64_t hash_in = 14695981039346656037ULL);
+bool read_file(const string_type& path_in, string_type& contents_out);
+bool write_file(const string_type& path_in, const string_type& contents_in);
+size_type get_file_mtime(const string_type& path_in);
+
+// the on disk caches are written with these; numbers are stored in host
+// byte order since a cache is only read on the machine that wrote it
+class binary_writer {
+    string_type buffer;
+
+    public:
+    void write_size(const size_type size_in);
+    void write_real(const double real_in);
+    void write_string(const string_type& string_in);
+    const string_type& get_buffer();
+};
+
+// reading past the end gives back zeros and marks the reader as failed
+// so a truncated or corrupt file can be checked for once at the end
+class binary_reader {
+    const string_type& buffer;
+    size_type position = 0;
+    bool failed = false;
+    bool read(void * dest_in, const size_type size_in);
+
+    public:
+    binary_reader(const string_type& buffer_in);
+    size_type read_size();
+    double read_real();
+    string_type read_string();
+    bool is_failed();
+    bool at_end();
+};
+
+// the wall clock time since it was made or restarted; used to report
+// how long each part of starting up took
+class stopwatch {
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    public:
+    real_type get_ms() const;
+    void restart();
+};
+
+// a view of contiguous elements owned by something else so a
+// caller can iterate them without a copy being made
+template <typename T>
+class span {
+    T * pointer = nullptr;
+    size_type length = 0;
+
+    public:
+    span() = default;
+    span(T * pointer_in, const size_type length_in)
+    : pointer(pointer_in), length(length_in)
+    { }
+    template <typename Container>
+    span(Container& container_in)
+    : pointer(container_in.data()), length(container_in.size())
+    { }
+    T * begin() const { return pointer; }
+    T * end() const { return pointer + length; }
+    T& operator[](const size_type index_in) const { return pointer[index_in]; }
+    size_type size() const { return length; }
+    bool empty() const { return length == 0; }
+};
 
 template <typename T>
 void sstream_accumulate_vaargs(stringstream_type& sstream, T&& t) {
@@ -38,8 +38,8 @@ node::node(const string_type& name_in, std::shared_ptr<pulsar::domain> domain_in
 {
     add_property("node:class", property::value_type::string).value->set("pulsar::portaudio::node");
     add_property("config:hz", property::value_type::integer);
-    add_property("config:max_cycles", property::value_type::integer);
-    add_property("state:cycle_num", property::value_type::integer);
+    max_cycles_id = add_property("config:max_cycles", property::value_type::integer).id;
+    cycle_num_id = add_property("state:cycle_num", property::value_type::integer).id;
 }
 
 void node::activate()
@@ -82,15 +82,15 @@ void node::handle_timer()
         busy_flag = true;
     }
 
-    auto zero_buffer = domain->get_zero_buffer();
-    auto& cycle_num = get_property("state:cycle_num").value->get_integer();
-    auto& max_cycles = get_property("config:max_cycles").value->get_integer();
+    domain->begin_cycle();
 
+    auto zero_buffer = domain->get_zero_buffer();
+    auto& cycle_num = get_property(cycle_num_id).value->get_integer();
+    auto& max_cycles = get_property(max_cycles_id).value->get_integer();
 
     cycle_num++;
 
-    for(auto&& name : audio.get_output_names()) {
-        auto output = audio.get_output(name);
+    for(auto&& output : audio.get_outputs()) {
         output->set_buffer(zero_buffer);
     }
 
@@ -30,6 +30,8 @@ class node : public pulsar::node::io {
     std::shared_ptr<async::timer> timer = nullptr;
     mutex_type busy_mutex;
     bool busy_flag = false;
+    size_type cycle_num_id;
+    size_type max_cycles_id;
     void start() override;
     void execute() override;
     void handle_timer();